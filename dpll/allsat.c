@@ -0,0 +1,327 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <assert.h>
+#include "dpll.h"
+
+// Occurrences of TRUE literals in clauses and extra clauses of the solver, rebuilt for every model.
+// Clauses of f are numbered first, extra clauses after them
+static size_t *OCC_START;  // indexed by lit + n_vars, CSR over OCC
+static uint32_t *OCC;
+static uint32_t *TRUE_CNT; // TRUE literals kept in clause
+// Binary implication graph is reduced and not symmetric any more: edge u -> w is clause (-u | w),
+// and clauses of a literal are its negation's out-edges together with its in-edges
+static size_t *IN_START;   // indexed by lit + n_vars, CSR over IN
+static int32_t *IN;
+
+static const Clause *
+shrink_clause(const Solver *s, size_t i) {
+    return i < s->f->n_clauses ? s->f->clauses + i : s->extra + (i - s->f->n_clauses);
+}
+
+// Desc: unset literals of variables with mark set in satisfying interpretation t, as long as every
+// clause, binary clause and extra clause keeps a TRUE literal. What is left is an implicant: all its
+// extensions are models
+// Returns number of unset literals
+static size_t
+allsat_shrink(const Solver *s, Tetrits t, const char *mark) {
+    const Formula *f = s->f;
+    int32_t n = s->n_vars;
+    size_t n_clauses = f->n_clauses + s->extra_size;
+    memset(OCC_START, 0, (2 * n + 2) * sizeof(*OCC_START));
+    size_t *start = OCC_START + n;
+    size_t total = 0;
+    for (size_t i = 0; i < n_clauses; ++i) {
+        const Clause *c = shrink_clause(s, i);
+        for (size_t j = 0; j < c->size; ++j) {
+            if (get(t, c->lits[j]) == TRUE) {
+                start[c->lits[j] + 1]++;
+                total++;
+            }
+        }
+    }
+    for (int32_t l = -n; l <= n; ++l) {
+        start[l + 1] += start[l];
+    }
+    OCC = realloc(OCC, (total ? total : 1) * sizeof(*OCC));
+    TRUE_CNT = realloc(TRUE_CNT, (n_clauses ? n_clauses : 1) * sizeof(*TRUE_CNT));
+    memset(TRUE_CNT, 0, n_clauses * sizeof(*TRUE_CNT));
+    for (size_t i = 0; i < n_clauses; ++i) {
+        const Clause *c = shrink_clause(s, i);
+        for (size_t j = 0; j < c->size; ++j) {
+            if (get(t, c->lits[j]) == TRUE) {
+                OCC[start[c->lits[j]]++] = i;
+                TRUE_CNT[i]++;
+            }
+        }
+    }
+    // Fill moved every start to the next literal's
+    for (int32_t l = n; l > -n; --l) {
+        start[l] = start[l - 1];
+    }
+    start[-n] = 0;
+
+    size_t dropped = 0;
+    for (int32_t v = 1; v <= n; ++v) {
+        if (!mark[v] || get(t, v) == UNSET) {
+            continue;
+        }
+        int32_t lit = get(t, v) == TRUE ? v : -v;
+        // Reduced graph is equivalent to the binary clauses, an implicant of it satisfies all of them
+        // Clause (lit | lit) is edge -lit -> lit, its other literal is lit itself
+        int needed = 0;
+        if (f->imp) {
+            for (size_t k = f->imp_start[-lit]; k < f->imp_start[-lit + 1] && !needed; ++k) {
+                needed = f->imp[k] == lit || get(t, f->imp[k]) != TRUE;
+            }
+            for (size_t k = IN_START[lit + n]; k < IN_START[lit + n + 1] && !needed; ++k) {
+                needed = IN[k] == -lit || get(t, IN[k]) != FALSE;
+            }
+        }
+        // Repeated literals are counted each time, so they are removed before the check
+        size_t k = start[lit];
+        for (; k < start[lit + 1]; ++k) {
+            TRUE_CNT[OCC[k]]--;
+        }
+        for (k = start[lit]; k < start[lit + 1] && !needed; ++k) {
+            needed = TRUE_CNT[OCC[k]] == 0;
+        }
+        if (needed) {
+            for (k = start[lit]; k < start[lit + 1]; ++k) {
+                TRUE_CNT[OCC[k]]++;
+            }
+            continue;
+        }
+        t[lit] = t[-lit] = UNSET;
+        dropped++;
+    }
+    return dropped;
+}
+
+// Desc: print assigned variables of t with mark set, all if mark is NULL, as a "v" line
+static void
+allsat_print(Tetrits t, size_t n_vars, const char *mark) {
+    putchar('v');
+    for (int32_t v = 1; v <= (int32_t)n_vars; ++v) {
+        if ((!mark || mark[v]) && get(t, v) != UNSET) {
+            printf(" %d", get(t, v) == TRUE ? v : -v);
+        }
+    }
+    printf(" 0\n");
+    // Models stream out, consumer may act on them before the enumeration ends
+    fflush(stdout);
+}
+
+static void
+allsat_alloc(const Formula *f) {
+    int32_t n = f->n_vars;
+    OCC_START = malloc((2 * n + 2) * sizeof(*OCC_START));
+    OCC = NULL;
+    TRUE_CNT = NULL;
+    IN_START = NULL;
+    IN = NULL;
+    if (!f->imp) {
+        return;
+    }
+    IN_START = calloc(2 * n + 2, sizeof(*IN_START));
+    for (int32_t u = -n; u <= n; ++u) {
+        for (size_t k = f->imp_start[u]; k < f->imp_start[u + 1]; ++k) {
+            IN_START[f->imp[k] + n + 1]++;
+        }
+    }
+    for (size_t i = 0; i < (size_t)(2 * n + 1); ++i) {
+        IN_START[i + 1] += IN_START[i];
+    }
+    IN = malloc((IN_START[2 * n + 1] ? IN_START[2 * n + 1] : 1) * sizeof(*IN));
+    size_t *fill = malloc((2 * n + 1) * sizeof(*fill));
+    memcpy(fill, IN_START, (2 * n + 1) * sizeof(*fill));
+    for (int32_t u = -n; u <= n; ++u) {
+        for (size_t k = f->imp_start[u]; k < f->imp_start[u + 1]; ++k) {
+            IN[fill[f->imp[k] + n]++] = u;
+        }
+    }
+    free(fill);
+}
+
+static void
+allsat_release(void) {
+    free(OCC_START);
+    free(OCC);
+    free(TRUE_CNT);
+    free(IN_START);
+    free(IN);
+}
+
+// Desc: projected variables of f, all variables without projection
+static char *
+allsat_proj(const Formula *f) {
+    char *proj = calloc(f->n_vars + 1, 1);
+    memset(proj + 1, f->n_proj == 0, f->n_vars);
+    for (size_t i = 0; i < f->n_proj; ++i) {
+        proj[f->proj[i]] = 1;
+    }
+    return proj;
+}
+
+SolverRes
+allsat_solve(const Formula *f, Tetrits root, Stats *stats) {
+    Solver s;
+    solver_init(&s, f, 0, root);
+    s.heuristic = HEURISTIC;
+    s.stop = &STOP;
+    s.stats = stats;
+    char *proj = allsat_proj(f);
+    uint64_t cubes = 0, blocked = 0;
+    SolverRes res;
+    if (f->n_proj == 0) {
+        // Satisfied frame is a cube of models, its unset variables are don't cares. Frames still on
+        // the stack are the unexplored rest of the search tree, so popping the model and continuing
+        // enumerates disjoint cubes without any blocking clause. Nothing is learned without restarts,
+        // which would wrongly refute the subtrees of found models
+        if (s.heuristic == H_LOOKAHEAD) {
+            // Look-ahead jumps to a satisfied probe and drops the rest of the frame
+            s.heuristic = H_FIRST;
+        }
+        res = solver_run(&s);
+        while (res == SAT) {
+            allsat_print(solver_model(&s), f->n_vars, NULL);
+            cubes++;
+            if (--s.stack_size == 0) {
+                break;
+            }
+            s.resumed = 1;
+            res = solver_run(&s);
+        }
+    } else {
+        // Models are projected: different models may share the projection, so each projection is
+        // blocked by a clause. Model is shrunk on projected variables first, blocking clause of the
+        // implicant excludes all its extensions at once. Implicant satisfies earlier blocking clauses,
+        // so cubes are disjoint
+        s.keep_learned = 1;
+        allsat_alloc(f);
+        res = solver_run(&s);
+        int32_t *block = malloc((f->n_vars + 1) * sizeof(*block));
+        while (res == SAT) {
+            Tetrits t = solver_model(&s);
+            allsat_shrink(&s, t, proj);
+            allsat_print(t, f->n_vars, proj);
+            cubes++;
+            size_t size = 0;
+            for (int32_t v = 1; v <= (int32_t)f->n_vars; ++v) {
+                if (proj[v] && get(t, v) != UNSET) {
+                    block[size++] = get(t, v) == TRUE ? -v : v;
+                }
+            }
+            if (size == 0) {
+                // Every projection is a model
+                break;
+            }
+            solver_add_extra(&s, block, size);
+            blocked++;
+            res = solver_run(&s);
+        }
+        free(block);
+        allsat_release();
+    }
+    fprintf(stderr, "c allsat: %lu cubes, %lu blocking clauses\n", cubes, blocked);
+    free(proj);
+    solver_free(&s);
+    if (res == UNKNOWN) {
+        return UNKNOWN;
+    }
+    return cubes ? SAT : UNSAT;
+}
+
+SolverRes
+backbone_solve(const Formula *f, Tetrits root, Stats *stats) {
+    Solver s;
+    solver_init(&s, f, 0, root);
+    s.heuristic = HEURISTIC;
+    s.stop = &STOP;
+    s.stats = stats;
+    s.keep_learned = 1;
+    SolverRes res = solver_run(&s);
+    if (res != SAT) {
+        solver_free(&s);
+        return res;
+    }
+    allsat_alloc(f);
+    // Candidates are literals of projected variables in every model seen so far, indexed by variable
+    char *cand = allsat_proj(f);
+    int32_t *value = calloc(f->n_vars + 1, sizeof(*value));
+    // Decisions go first on candidates and against them, so every model rules out as many of them
+    // as it can. Look-ahead would pick its own variables, it is used for the first model only
+    s.heuristic = H_FIRST;
+    s.phase = tetrits_alloc(f->n_vars);
+    s.polarity = POL_PHASE;
+    uint64_t calls = 1, found = 0;
+    int32_t assumption;
+    s.assumptions = &assumption;
+    s.n_assumptions = 1;
+    int32_t next = 1;
+    for (;;) {
+        if (res == SAT) {
+            // Model filter: candidate which is FALSE or don't care in a model is no backbone
+            // literal. Literals the shrunk model does without are don't cares as well, that rules
+            // out most candidates before any call of their own
+            Tetrits t = solver_model(&s);
+            allsat_shrink(&s, t, cand);
+            for (int32_t v = 1; v <= (int32_t)f->n_vars; ++v) {
+                if (!cand[v]) {
+                    continue;
+                }
+                int32_t lit = get(t, v) == TRUE ? v : get(t, v) == FALSE ? -v : 0;
+                if (lit == 0 || (value[v] && value[v] != lit)) {
+                    cand[v] = 0;
+                } else if (!value[v]) {
+                    value[v] = lit;
+                    set(s.phase, -lit);
+                }
+            }
+            size_t pos = 0;
+            for (int32_t v = 1; v <= (int32_t)f->n_vars; ++v) {
+                if (cand[v]) {
+                    s.order[pos++] = v;
+                }
+            }
+            for (int32_t v = 1; v <= (int32_t)f->n_vars; ++v) {
+                if (!cand[v]) {
+                    s.order[pos++] = v;
+                }
+            }
+        }
+        while (next <= (int32_t)f->n_vars && !cand[next]) {
+            next++;
+        }
+        if (next > (int32_t)f->n_vars) {
+            res = SAT;
+            break;
+        }
+        // Candidate holds in all models if the formula is UNSAT without it
+        assumption = -value[next];
+        res = solver_run(&s);
+        calls++;
+        if (res == UNKNOWN) {
+            break;
+        }
+        if (res == UNSAT) {
+            printf("b %d\n", value[next]);
+            fflush(stdout);
+            found++;
+            cand[next] = 0;
+            // Known backbone literal prunes later calls
+            solver_add_extra(&s, value + next, 1);
+        }
+    }
+    if (res == SAT) {
+        printf("b 0\n");
+    }
+    fprintf(stderr, "c backbone: %lu literals, %lu solver calls\n", found, calls);
+    free(cand);
+    free(value);
+    tetrits_free(s.phase, f->n_vars);
+    allsat_release();
+    solver_free(&s);
+    return res;
+}
@@ -0,0 +1,429 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <assert.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+// Benchmark runner: solves a corpus of CNFs in parallel processes, writes CSV and PAR-2 score
+
+#define BENCH_POLL_NS 10000000  // interval of timeout and memory checks of running instances
+#define BENCH_MAX_ARGS 64       // solver command words
+#define BENCH_KILL_GRACE 2.0    // seconds between interrupt at timeout and kill
+
+typedef enum Status {
+    ST_SAT,
+    ST_UNSAT,
+    ST_UNKNOWN,
+    ST_TIMEOUT,
+    ST_MEMOUT,
+    ST_ERROR
+} Status;
+
+static const char *STATUS_NAMES[] = {"SAT", "UNSAT", "UNKNOWN", "TIMEOUT", "MEMOUT", "ERROR"};
+
+typedef struct Instance {
+    char *path;
+    off_t size;
+    Status status;
+    double time;             // wall-clock seconds
+    long rss;                // peak resident set, KiB
+    uint64_t decisions;
+    uint64_t conflicts;
+    // While running
+    pid_t pid;
+    double start;
+    FILE *out, *err;
+    char killed;             // 1: interrupted, so it prints stats, 2: killed
+} Instance;
+
+// Options
+static size_t JOBS = 1;
+static double TIMEOUT = 60;
+static long MEMORY = 0;      // MiB, 0 is unlimited
+static size_t SAMPLE = 0;    // run only this many instances spread over sizes, 0 is all
+static char *SOLVER[BENCH_MAX_ARGS + 2] = {"./dpll"};
+static size_t SOLVER_ARGS = 1;
+
+static Instance *INSTANCES;
+static size_t N_INSTANCES, INSTANCES_CAP;
+
+static double
+now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int
+is_cnf(const char *name) {
+    static const char *EXTS[] = {".cnf", ".cnf.gz", ".cnf.xz"};
+    size_t len = strlen(name);
+    for (size_t i = 0; i < sizeof(EXTS) / sizeof(*EXTS); ++i) {
+        size_t ext = strlen(EXTS[i]);
+        if (len > ext && !strcmp(name + len - ext, EXTS[i])) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void
+add_instance(const char *path, off_t size) {
+    if (N_INSTANCES == INSTANCES_CAP) {
+        INSTANCES_CAP = INSTANCES_CAP ? 2 * INSTANCES_CAP : 64;
+        INSTANCES = realloc(INSTANCES, INSTANCES_CAP * sizeof(*INSTANCES));
+    }
+    Instance *in = INSTANCES + N_INSTANCES++;
+    memset(in, 0, sizeof(*in));
+    in->path = strdup(path);
+    in->size = size;
+}
+
+// Desc: add file, or every CNF of directory and its subdirectories
+static void
+collect(const char *path) {
+    struct stat st;
+    if (stat(path, &st)) {
+        perror(path);
+        exit(1);
+    }
+    if (!S_ISDIR(st.st_mode)) {
+        add_instance(path, st.st_size);
+        return;
+    }
+    DIR *dir = opendir(path);
+    if (!dir) {
+        perror(path);
+        exit(1);
+    }
+    struct dirent *e;
+    while ((e = readdir(dir))) {
+        if (e->d_name[0] == '.') {
+            continue;
+        }
+        char *sub = malloc(strlen(path) + strlen(e->d_name) + 2);
+        sprintf(sub, "%s/%s", path, e->d_name);
+        if (stat(sub, &st) == 0 && (S_ISDIR(st.st_mode) || is_cnf(e->d_name))) {
+            collect(sub);
+        }
+        free(sub);
+    }
+    closedir(dir);
+}
+
+static int
+path_cmp(const void *a, const void *b) {
+    return strcmp(((const Instance *)a)->path, ((const Instance *)b)->path);
+}
+
+static int
+size_cmp(const void *a, const void *b) {
+    off_t x = ((const Instance *)a)->size, y = ((const Instance *)b)->size;
+    return x < y ? -1 : x > y;
+}
+
+// Desc: keep SAMPLE instances evenly spaced in the order of file size, smallest and largest included
+static void
+sample(void) {
+    if (SAMPLE == 0 || SAMPLE >= N_INSTANCES) {
+        return;
+    }
+    qsort(INSTANCES, N_INSTANCES, sizeof(*INSTANCES), size_cmp);
+    for (size_t i = 0, j = 0; j < N_INSTANCES; ++j) {
+        size_t pick = SAMPLE == 1 ? 0 : i * (N_INSTANCES - 1) / (SAMPLE - 1);
+        if (i < SAMPLE && j == pick) {
+            INSTANCES[i++] = INSTANCES[j];
+        } else {
+            free(INSTANCES[j].path);
+        }
+    }
+    N_INSTANCES = SAMPLE;
+    qsort(INSTANCES, N_INSTANCES, sizeof(*INSTANCES), path_cmp);
+}
+
+static void
+launch(Instance *in) {
+    in->out = tmpfile();
+    in->err = tmpfile();
+    if (!in->out || !in->err) {
+        perror("tmpfile");
+        exit(1);
+    }
+    in->start = now();
+    in->pid = fork();
+    if (in->pid < 0) {
+        perror("fork");
+        exit(1);
+    }
+    if (in->pid == 0) {
+        dup2(fileno(in->out), 1);
+        dup2(fileno(in->err), 2);
+        SOLVER[SOLVER_ARGS] = in->path;
+        execvp(SOLVER[0], SOLVER);
+        perror(SOLVER[0]);
+        _exit(127);
+    }
+}
+
+// Returns resident set of running process in KiB, 0 if unknown
+static long
+rss_of(pid_t pid) {
+    char path[64];
+    sprintf(path, "/proc/%d/statm", (int)pid);
+    FILE *fp = fopen(path, "r");
+    long size, resident = 0;
+    if (fp) {
+        if (fscanf(fp, "%ld %ld", &size, &resident) != 2) {
+            resident = 0;
+        }
+        fclose(fp);
+    }
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+// Desc: read result line from solver output and search counters from its stderr
+static void
+finish(Instance *in, int status, const struct rusage *ru) {
+    in->time = now() - in->start;
+    in->rss = ru->ru_maxrss;
+    char line[256];
+    rewind(in->err);
+    while (fgets(line, sizeof(line), in->err)) {
+        // Final stats are JSON, one field per line
+        unsigned long value;
+        if (sscanf(line, " \"decisions\": %lu", &value) == 1) {
+            in->decisions = value;
+        } else if (sscanf(line, " \"conflicts\": %lu", &value) == 1) {
+            in->conflicts = value;
+        }
+    }
+    if (in->killed) {
+        // Status is set by the killer
+    } else if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        in->status = ST_ERROR;
+    } else {
+        rewind(in->out);
+        in->status = ST_UNKNOWN;
+        if (fgets(line, sizeof(line), in->out)) {
+            if (!strcmp(line, "SAT\n")) {
+                in->status = ST_SAT;
+            } else if (!strcmp(line, "UNSAT\n")) {
+                in->status = ST_UNSAT;
+            }
+        }
+    }
+    fclose(in->out);
+    fclose(in->err);
+    in->pid = 0;
+}
+
+static void
+run_all(void) {
+    size_t next = 0, running = 0, done = 0;
+    while (done < N_INSTANCES) {
+        while (running < JOBS && next < N_INSTANCES) {
+            launch(INSTANCES + next++);
+            running++;
+        }
+        int status;
+        struct rusage ru;
+        pid_t pid;
+        while ((pid = wait4(-1, &status, WNOHANG, &ru)) > 0) {
+            for (size_t i = 0; i < next; ++i) {
+                if (INSTANCES[i].pid == pid) {
+                    finish(INSTANCES + i, status, &ru);
+                    fprintf(stderr, "c bench: %-40s %-7s %8.2f s\n", INSTANCES[i].path,
+                            STATUS_NAMES[INSTANCES[i].status], INSTANCES[i].time);
+                    running--;
+                    done++;
+                    break;
+                }
+            }
+        }
+        double t = now();
+        for (size_t i = 0; i < next; ++i) {
+            Instance *in = INSTANCES + i;
+            if (!in->pid || in->killed == 2) {
+                continue;
+            }
+            if (MEMORY && rss_of(in->pid) > MEMORY * 1024) {
+                in->killed = 2;
+                in->status = ST_MEMOUT;
+                kill(in->pid, SIGKILL);
+            } else if (in->killed == 0 && t - in->start > TIMEOUT) {
+                in->killed = 1;
+                in->status = ST_TIMEOUT;
+                kill(in->pid, SIGINT);
+            } else if (in->killed == 1 && t - in->start > TIMEOUT + BENCH_KILL_GRACE) {
+                in->killed = 2;
+                kill(in->pid, SIGKILL);
+            }
+        }
+        struct timespec ts = {0, BENCH_POLL_NS};
+        nanosleep(&ts, NULL);
+    }
+}
+
+// Returns PAR-2 time of instance: solving time, or twice the timeout if unsolved
+static double
+par2(Status status, double time) {
+    return status == ST_SAT || status == ST_UNSAT ? time : 2 * TIMEOUT;
+}
+
+static void
+write_csv(const char *path) {
+    FILE *fp = path ? fopen(path, "w") : stdout;
+    if (!fp) {
+        perror(path);
+        exit(1);
+    }
+    fprintf(fp, "instance,status,time,rss_kb,decisions,conflicts\n");
+    for (size_t i = 0; i < N_INSTANCES; ++i) {
+        Instance *in = INSTANCES + i;
+        fprintf(fp, "%s,%s,%.3f,%ld,%lu,%lu\n", in->path, STATUS_NAMES[in->status], in->time,
+                in->rss, in->decisions, in->conflicts);
+    }
+    if (path) {
+        fclose(fp);
+    }
+}
+
+// Desc: compare with results of earlier run on the instances both have
+// Returns 1 if some instance got contradicting answers
+static int
+compare(const char *path) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        perror(path);
+        exit(1);
+    }
+    char line[4096];
+    size_t common = 0, solved = 0, base_solved = 0;
+    double score = 0, base_score = 0;
+    int wrong = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        char *name = strtok(line, ","), *status = strtok(NULL, ","), *time = strtok(NULL, ",");
+        if (!time || !strcmp(name, "instance")) {
+            continue;
+        }
+        Status base = ST_ERROR;
+        for (size_t s = 0; s <= ST_ERROR; ++s) {
+            if (!strcmp(status, STATUS_NAMES[s])) {
+                base = s;
+            }
+        }
+        double base_time = atof(time);
+        for (size_t i = 0; i < N_INSTANCES; ++i) {
+            Instance *in = INSTANCES + i;
+            if (strcmp(in->path, name)) {
+                continue;
+            }
+            common++;
+            solved += in->status == ST_SAT || in->status == ST_UNSAT;
+            base_solved += base == ST_SAT || base == ST_UNSAT;
+            score += par2(in->status, in->time);
+            base_score += par2(base, base_time);
+            if ((in->status == ST_SAT && base == ST_UNSAT) || (in->status == ST_UNSAT && base == ST_SAT)) {
+                fprintf(stderr, "c bench: %s answered %s, baseline %s\n", name, STATUS_NAMES[in->status],
+                        STATUS_NAMES[base]);
+                wrong = 1;
+            } else if (in->status != base) {
+                fprintf(stderr, "c bench: %s %s, baseline %s\n", name, STATUS_NAMES[in->status],
+                        STATUS_NAMES[base]);
+            }
+            break;
+        }
+    }
+    fclose(fp);
+    if (common) {
+        fprintf(stderr, "c bench: baseline %lu common instances, solved %lu vs %lu, PAR-2 %.2f vs %.2f (%.2fx)\n",
+                common, solved, base_solved, score / common, base_score / common,
+                score > 0 ? base_score / score : 1.0);
+    } else {
+        fprintf(stderr, "c bench: baseline has no common instances\n");
+    }
+    return wrong;
+}
+
+static void
+usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-j JOBS] [-t SECONDS] [-m MIB] [-n SAMPLE] [-s SOLVER] [-a ARG]... "
+            "[-o out.csv] [-b baseline.csv] dir|file.cnf...\n", prog);
+    exit(1);
+}
+
+int
+main(int argc, char *argv[]) {
+    const char *out = NULL, *baseline = NULL;
+    int i = 1;
+    for (; i < argc && argv[i][0] == '-'; ++i) {
+        if (i + 1 == argc || strlen(argv[i]) != 2) {
+            usage(argv[0]);
+        }
+        char *val = argv[++i];
+        switch (argv[i - 1][1]) {
+            case 'j':
+                JOBS = atoi(val) > 0 ? atoi(val) : 1;
+                break;
+            case 't':
+                TIMEOUT = atof(val);
+                break;
+            case 'm':
+                MEMORY = atol(val);
+                break;
+            case 'n':
+                SAMPLE = atoi(val);
+                break;
+            case 's':
+                SOLVER[0] = val;
+                break;
+            case 'a':
+                if (SOLVER_ARGS == BENCH_MAX_ARGS) {
+                    usage(argv[0]);
+                }
+                SOLVER[SOLVER_ARGS++] = val;
+                break;
+            case 'o':
+                out = val;
+                break;
+            case 'b':
+                baseline = val;
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+    if (i == argc) {
+        usage(argv[0]);
+    }
+    for (; i < argc; ++i) {
+        collect(argv[i]);
+    }
+    qsort(INSTANCES, N_INSTANCES, sizeof(*INSTANCES), path_cmp);
+    sample();
+
+    run_all();
+    write_csv(out);
+    size_t solved = 0;
+    double score = 0;
+    for (size_t j = 0; j < N_INSTANCES; ++j) {
+        solved += INSTANCES[j].status == ST_SAT || INSTANCES[j].status == ST_UNSAT;
+        score += par2(INSTANCES[j].status, INSTANCES[j].time);
+    }
+    fprintf(stderr, "c bench: %lu/%lu solved, PAR-2 %.2f\n", solved, N_INSTANCES,
+            N_INSTANCES ? score / N_INSTANCES : 0.0);
+    int wrong = baseline ? compare(baseline) : 0;
+    for (size_t j = 0; j < N_INSTANCES; ++j) {
+        free(INSTANCES[j].path);
+    }
+    free(INSTANCES);
+    return wrong;
+}
@@ -0,0 +1,267 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <assert.h>
+#include "dpll.h"
+
+// Implication graph tuning
+#define BIN_REDUCE_STEPS 20000000  // edge visits spent on transitive reduction
+#define BIN_MIN_SHARE 8            // graph is built if at least 1 of this many clauses is binary
+
+#define REMOVED SIZE_MAX
+
+// Graph on literals in CSR form, arrays are indexed by lit + N
+static size_t N;
+static size_t *START;
+static int32_t *EDGES;
+
+// Desc: Tarjan's SCC of the literal graph, iterative
+// Returns number of components; comp[lit + N] is component, components are numbered in reverse
+// topological order: every edge goes from a higher number to a lower or equal one
+static size_t
+binary_scc(size_t *comp) {
+    size_t n = 2 * N + 1;
+    size_t *index = calloc(n, sizeof(*index)), *low = malloc(n * sizeof(*low));
+    size_t *stack = malloc(n * sizeof(*stack)), *call = malloc(n * sizeof(*call));
+    size_t *edge = malloc(n * sizeof(*edge));
+    char *on_stack = calloc(n, 1);
+    size_t counter = 0, stack_size = 0, n_comps = 0;
+    for (size_t root = 0; root < n; ++root) {
+        if (index[root]) {
+            continue;
+        }
+        size_t depth = 0;
+        call[depth++] = root;
+        index[root] = low[root] = ++counter;
+        edge[root] = START[root];
+        stack[stack_size++] = root;
+        on_stack[root] = 1;
+        while (depth) {
+            size_t u = call[depth - 1];
+            if (edge[u] < START[u + 1]) {
+                size_t w = EDGES[edge[u]++] + N;
+                if (!index[w]) {
+                    index[w] = low[w] = ++counter;
+                    edge[w] = START[w];
+                    stack[stack_size++] = w;
+                    on_stack[w] = 1;
+                    call[depth++] = w;
+                } else if (on_stack[w] && index[w] < low[u]) {
+                    low[u] = index[w];
+                }
+                continue;
+            }
+            depth--;
+            if (depth && low[u] < low[call[depth - 1]]) {
+                low[call[depth - 1]] = low[u];
+            }
+            if (low[u] == index[u]) {
+                size_t w;
+                do {
+                    w = stack[--stack_size];
+                    on_stack[w] = 0;
+                    comp[w] = n_comps;
+                } while (w != u);
+                n_comps++;
+            }
+        }
+    }
+    free(index);
+    free(low);
+    free(stack);
+    free(call);
+    free(edge);
+    free(on_stack);
+    return n_comps;
+}
+
+// Desc: remove edges of condensation DAG which are implied by longer paths, while budget lasts.
+// Components are processed sinks first, so paths below are already reduced. Removed edges are REMOVED
+static size_t
+binary_reduce(size_t n_comps, const size_t *dag_start, size_t *dag) {
+    size_t *mark = calloc(n_comps, sizeof(*mark));
+    // Direct successors and marked components, each at most once
+    size_t *todo = malloc(2 * n_comps * sizeof(*todo));
+    uint64_t budget = BIN_REDUCE_STEPS;
+    size_t removed = 0;
+    for (size_t c = 0; c < n_comps && budget; ++c) {
+        // Mark components reachable from c by paths of two or more edges
+        size_t todo_size = 0, stamp = c + 1;
+        for (size_t k = dag_start[c]; k < dag_start[c + 1]; ++k) {
+            if (dag[k] != REMOVED) {
+                todo[todo_size++] = dag[k];
+            }
+        }
+        while (todo_size && budget) {
+            size_t x = todo[--todo_size];
+            for (size_t j = dag_start[x]; j < dag_start[x + 1] && budget; ++j, --budget) {
+                if (dag[j] != REMOVED && mark[dag[j]] != stamp) {
+                    mark[dag[j]] = stamp;
+                    todo[todo_size++] = dag[j];
+                }
+            }
+        }
+        // Marks are reachable even if budget ran out
+        for (size_t k = dag_start[c]; k < dag_start[c + 1]; ++k) {
+            if (dag[k] != REMOVED && mark[dag[k]] == stamp) {
+                dag[k] = REMOVED;
+                removed++;
+            }
+        }
+    }
+    free(mark);
+    free(todo);
+    return removed;
+}
+
+static int
+comp_cmp(const void *l, const void *r) {
+    size_t a = *(const size_t *)l, b = *(const size_t *)r;
+    return (a > b) - (a < b);
+}
+
+void
+binary_build(Formula *f) {
+    N = f->n_vars;
+    size_t n = 2 * N + 1, n_binary = 0;
+    START = calloc(n + 1, sizeof(*START));
+    for (size_t i = 0; i < f->n_clauses; ++i) {
+        if (f->clauses[i].size == 2) {
+            START[-f->clauses[i].lits[0] + N + 1]++;
+            START[-f->clauses[i].lits[1] + N + 1]++;
+            n_binary++;
+        }
+    }
+    // Seeding the graph from all assigned literals costs more than a few binary clauses in the scan
+    if (!n_binary || n_binary * BIN_MIN_SHARE < f->n_clauses) {
+        free(START);
+        return;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        START[i + 1] += START[i];
+    }
+    // Clause (a b) gives edges -a -> b and -b -> a
+    EDGES = malloc(START[n] * sizeof(*EDGES));
+    size_t *fill = malloc(n * sizeof(*fill));
+    memcpy(fill, START, n * sizeof(*fill));
+    size_t kept = 0;
+    for (size_t i = 0; i < f->n_clauses; ++i) {
+        Clause c = f->clauses[i];
+        if (c.size == 2) {
+            EDGES[fill[-c.lits[0] + N]++] = c.lits[1];
+            EDGES[fill[-c.lits[1] + N]++] = c.lits[0];
+        } else {
+            f->clauses[kept++] = c;
+        }
+    }
+    f->n_clauses = kept;
+    free(fill);
+
+    // Literals of a component are equivalent, component gets edges of all of them
+    size_t *comp = malloc(n * sizeof(*comp));
+    size_t n_comps = binary_scc(comp);
+    size_t *comp_size = calloc(n_comps, sizeof(*comp_size));
+    int32_t *rep = malloc(n_comps * sizeof(*rep));
+    int32_t *ring = calloc(n, sizeof(*ring));     // next literal of the same component
+    int32_t *last = calloc(n_comps, sizeof(*last));
+    for (size_t i = 0; i < n; ++i) {
+        int32_t lit = (int32_t)i - (int32_t)N;
+        size_t c = comp[i];
+        if (comp_size[c]++ == 0) {
+            rep[c] = lit;
+        } else {
+            ring[last[c] + N] = lit;
+        }
+        last[c] = lit;
+    }
+    size_t equivalent = 0;
+    for (size_t c = 0; c < n_comps; ++c) {
+        if (comp_size[c] > 1) {
+            ring[last[c] + N] = rep[c];
+            equivalent += comp_size[c] - 1;
+        }
+    }
+
+    // Condensation DAG, sorted and without duplicates
+    size_t *dag_start = calloc(n_comps + 1, sizeof(*dag_start));
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t k = START[i]; k < START[i + 1]; ++k) {
+            if (comp[EDGES[k] + N] != comp[i]) {
+                dag_start[comp[i] + 1]++;
+            }
+        }
+    }
+    for (size_t c = 0; c < n_comps; ++c) {
+        dag_start[c + 1] += dag_start[c];
+    }
+    size_t *dag = malloc((dag_start[n_comps] ? dag_start[n_comps] : 1) * sizeof(*dag));
+    fill = malloc(n_comps * sizeof(*fill));
+    memcpy(fill, dag_start, n_comps * sizeof(*fill));
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t k = START[i]; k < START[i + 1]; ++k) {
+            size_t target = comp[EDGES[k] + N];
+            if (target != comp[i]) {
+                dag[fill[comp[i]]++] = target;
+            }
+        }
+    }
+    // Duplicates are removed edges too
+    for (size_t c = 0; c < n_comps; ++c) {
+        size_t *list = dag + dag_start[c], size = dag_start[c + 1] - dag_start[c];
+        qsort(list, size, sizeof(*list), comp_cmp);
+        for (size_t k = 1; k < size; ++k) {
+            if (list[k] == list[k - 1]) {
+                list[k - 1] = REMOVED;
+            }
+        }
+    }
+    size_t removed = binary_reduce(n_comps, dag_start, dag);
+
+    // Final graph: ring edge inside component, representative has reduced edges to other representatives
+    size_t *imp_start = calloc(n + 1, sizeof(*imp_start));
+    for (size_t i = 0; i < n; ++i) {
+        int32_t lit = (int32_t)i - (int32_t)N;
+        size_t c = comp[i];
+        size_t deg = comp_size[c] > 1;
+        if (rep[c] == lit) {
+            for (size_t k = dag_start[c]; k < dag_start[c + 1]; ++k) {
+                deg += dag[k] != REMOVED;
+            }
+        }
+        imp_start[i + 1] = imp_start[i] + deg;
+    }
+    int32_t *imp = malloc((imp_start[n] ? imp_start[n] : 1) * sizeof(*imp));
+    for (size_t i = 0; i < n; ++i) {
+        int32_t lit = (int32_t)i - (int32_t)N;
+        size_t c = comp[i], out = imp_start[i];
+        if (comp_size[c] > 1) {
+            imp[out++] = ring[i];
+        }
+        if (rep[c] == lit) {
+            for (size_t k = dag_start[c]; k < dag_start[c + 1]; ++k) {
+                if (dag[k] != REMOVED) {
+                    imp[out++] = rep[dag[k]];
+                }
+            }
+        }
+        assert(out == imp_start[i + 1]);
+    }
+    f->imp_start = imp_start + N;
+    f->imp = imp;
+    fprintf(stderr, "c binary: %lu clauses, %lu equivalent literals, %lu edges, %lu transitive removed\n",
+            n_binary, equivalent, imp_start[n], removed);
+
+    free(comp);
+    free(comp_size);
+    free(rep);
+    free(ring);
+    free(last);
+    free(dag_start);
+    free(dag);
+    free(fill);
+    free(START);
+    free(EDGES);
+    START = NULL;
+    EDGES = NULL;
+}
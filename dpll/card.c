@@ -0,0 +1,256 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <assert.h>
+#include "dpll.h"
+
+// Cardinality tuning
+#define CARD_MIN_AMO 3            // smallest clique of binary clauses replaced by an at-most-one
+#define CARD_MAX_DEGREE 2000      // literals in more binary clauses do not start cliques, ranking is quadratic
+
+void
+formula_add_card(Formula *f, const int32_t *lits, size_t size, size_t bound) {
+    for (size_t i = 0; i < size; ++i) {
+        size_t var = lits[i] > 0 ? lits[i] : -lits[i];
+        f->n_vars = var > f->n_vars ? var : f->n_vars;
+    }
+    if (bound >= size) {
+        return;
+    }
+    if (f->n_cards == f->cards_cap) {
+        f->cards_cap = f->cards_cap ? 2 * f->cards_cap : 16;
+        f->cards = realloc(f->cards, f->cards_cap * sizeof(*f->cards));
+    }
+    Card *c = f->cards + f->n_cards++;
+    c->size = size;
+    c->lits = malloc(size * sizeof(*c->lits));
+    memcpy(c->lits, lits, size * sizeof(*c->lits));
+    c->bound = bound;
+}
+
+// Graph of binary clauses: clause (a | b) is an edge between -a and -b, at most one of them is TRUE.
+// Neighbors of literal l are ADJ[ADJ_START[l]] .. ADJ[ADJ_START[l + 1] - 1], sorted
+static size_t *ADJ_START;
+static int32_t *ADJ;
+static char *COVERED;      // edge is in a found clique
+
+static int
+lit_cmp(const void *l, const void *r) {
+    int32_t a = *(const int32_t *)l, b = *(const int32_t *)r;
+    return (a > b) - (a < b);
+}
+
+// Neighbor of the clique seed, with number of neighbors they share
+typedef struct Cand {
+    int32_t lit;
+    size_t common;
+} Cand;
+
+static int
+cand_cmp(const void *l, const void *r) {
+    const Cand *a = l, *b = r;
+    if (a->common != b->common) {
+        return a->common > b->common ? -1 : 1;
+    }
+    return (a->lit > b->lit) - (a->lit < b->lit);
+}
+
+// Returns slot of edge u - w, or SIZE_MAX if there is none
+static size_t
+card_edge(int32_t u, int32_t w) {
+    const int32_t *first = ADJ + ADJ_START[u];
+    const int32_t *found = bsearch(&w, first, ADJ_START[u + 1] - ADJ_START[u], sizeof(*ADJ), lit_cmp);
+    return found ? (size_t)(found - ADJ) : SIZE_MAX;
+}
+
+size_t
+card_detect(Formula *f) {
+    int32_t n = f->n_vars;
+    ADJ_START = (size_t *)calloc(2 * n + 2, sizeof(*ADJ_START)) + n;
+    size_t n_binary = 0;
+    for (size_t i = 0; i < f->n_clauses; ++i) {
+        const Clause *c = f->clauses + i;
+        if (c->size == 2 && c->lits[0] != -c->lits[1] && c->lits[0] != c->lits[1]) {
+            ADJ_START[-c->lits[0] + 1]++;
+            ADJ_START[-c->lits[1] + 1]++;
+            n_binary++;
+        }
+    }
+    if (n_binary < CARD_MIN_AMO) {
+        free(ADJ_START - n);
+        return 0;
+    }
+    for (int32_t l = -n; l <= n; ++l) {
+        ADJ_START[l + 1] += ADJ_START[l];
+    }
+    ADJ = malloc(2 * n_binary * sizeof(*ADJ));
+    size_t *fill = malloc((2 * n + 1) * sizeof(*fill));
+    memcpy(fill, ADJ_START - n, (2 * n + 1) * sizeof(*fill));
+    fill += n;
+    for (size_t i = 0; i < f->n_clauses; ++i) {
+        const Clause *c = f->clauses + i;
+        if (c->size == 2 && c->lits[0] != -c->lits[1] && c->lits[0] != c->lits[1]) {
+            ADJ[fill[-c->lits[0]]++] = -c->lits[1];
+            ADJ[fill[-c->lits[1]]++] = -c->lits[0];
+        }
+    }
+    free(fill - n);
+    // Duplicate clauses give duplicate neighbors, they are harmless for lookup
+    for (int32_t l = -n; l <= n; ++l) {
+        qsort(ADJ + ADJ_START[l], ADJ_START[l + 1] - ADJ_START[l], sizeof(*ADJ), lit_cmp);
+    }
+    COVERED = calloc(2 * n_binary, 1);
+
+    // Greedy cliques: from every literal with two uncovered edges, neighbors join while they are
+    // adjacent to all members, those sharing most neighbors with it first. Literals of one variable
+    // are never adjacent, (l | -l) is a tautology
+    int32_t *clique = malloc((2 * n + 1) * sizeof(*clique));
+    Cand *cand = malloc((CARD_MAX_DEGREE + 1) * sizeof(*cand));
+    char *mark = (char *)calloc(2 * n + 1, 1) + n;
+    size_t found = 0;
+    for (int32_t u = -n; u <= n; ++u) {
+        size_t degree = ADJ_START[u + 1] - ADJ_START[u];
+        if (degree < CARD_MIN_AMO - 1 || degree > CARD_MAX_DEGREE) {
+            continue;
+        }
+        size_t open = 0;
+        for (size_t k = ADJ_START[u]; k < ADJ_START[u + 1] && open < 2; ++k) {
+            open += !COVERED[k];
+        }
+        if (open < 2) {
+            continue;
+        }
+        size_t n_cand = 0;
+        for (size_t k = ADJ_START[u]; k < ADJ_START[u + 1]; ++k) {
+            if (!mark[ADJ[k]]) {
+                mark[ADJ[k]] = 1;
+                cand[n_cand++] = (Cand){ADJ[k], 0};
+            }
+        }
+        for (size_t i = 0; i < n_cand; ++i) {
+            int32_t w = cand[i].lit;
+            for (size_t k = ADJ_START[w]; k < ADJ_START[w + 1]; ++k) {
+                cand[i].common += mark[ADJ[k]];
+            }
+        }
+        for (size_t i = 0; i < n_cand; ++i) {
+            mark[cand[i].lit] = 0;
+        }
+        qsort(cand, n_cand, sizeof(*cand), cand_cmp);
+        size_t size = 0;
+        clique[size++] = u;
+        for (size_t i = 0; i < n_cand; ++i) {
+            int32_t w = cand[i].lit;
+            size_t j = 1;
+            while (j < size && card_edge(w, clique[j]) != SIZE_MAX) {
+                j++;
+            }
+            if (j == size) {
+                clique[size++] = w;
+            }
+        }
+        if (size < CARD_MIN_AMO) {
+            continue;
+        }
+        // Worth it if removed clauses have more literals than the constraint
+        size_t fresh = 0;
+        for (size_t i = 0; i < size; ++i) {
+            for (size_t j = i + 1; j < size; ++j) {
+                fresh += !COVERED[card_edge(clique[i], clique[j])];
+            }
+        }
+        if (2 * fresh < size) {
+            continue;
+        }
+        for (size_t i = 0; i < size; ++i) {
+            for (size_t j = i + 1; j < size; ++j) {
+                COVERED[card_edge(clique[i], clique[j])] = 1;
+                COVERED[card_edge(clique[j], clique[i])] = 1;
+            }
+        }
+        formula_add_card(f, clique, size, 1);
+        found++;
+    }
+
+    // Binary clauses of covered edges are implied by the constraints
+    size_t kept = 0;
+    for (size_t i = 0; i < f->n_clauses; ++i) {
+        const Clause *c = f->clauses + i;
+        if (c->size == 2 && c->lits[0] != -c->lits[1] && c->lits[0] != c->lits[1]
+                && COVERED[card_edge(-c->lits[0], -c->lits[1])]) {
+            continue;
+        }
+        f->clauses[kept++] = f->clauses[i];
+    }
+    size_t removed = f->n_clauses - kept;
+    f->n_clauses = kept;
+    free(clique);
+    free(cand);
+    free(mark - n);
+    free(COVERED);
+    free(ADJ);
+    free(ADJ_START - n);
+    if (found) {
+        fprintf(stderr, "c card: %lu at-most-one constraints replace %lu binary clauses\n", found, removed);
+    }
+    return found;
+}
+
+SolverRes
+card_propagate(Solver *s, Tetrits t, int32_t *units, size_t *n_units) {
+    const Formula *f = s->f;
+    int open = 0;
+    *n_units = 0;
+    for (size_t i = 0; i < f->n_cards; ++i) {
+        const Card *c = f->cards + i;
+        size_t count = 0, unset = 0;
+        for (size_t j = 0; j < c->size; ++j) {
+            State v = get(t, c->lits[j]);
+            count += v == TRUE;
+            unset += v == UNSET;
+        }
+        if (count > c->bound) {
+            return UNSAT;
+        }
+        if (count + unset <= c->bound) {
+            // Holds whatever the rest is
+            continue;
+        }
+        if (count < c->bound) {
+            open = 1;
+            continue;
+        }
+        // Counter reached the bound, other literals are FALSE
+        for (size_t j = 0; j < c->size; ++j) {
+            if (get(t, c->lits[j]) == UNSET) {
+                set(t, -c->lits[j]);
+                units[(*n_units)++] = -c->lits[j];
+            }
+        }
+    }
+    return open || *n_units ? UNKNOWN : SAT;
+}
+
+void
+card_score(const Formula *f, Tetrits t, double *score) {
+    for (size_t i = 0; i < f->n_cards; ++i) {
+        const Card *c = f->cards + i;
+        size_t count = 0, unset = 0;
+        for (size_t j = 0; j < c->size; ++j) {
+            State v = get(t, c->lits[j]);
+            count += v == TRUE;
+            unset += v == UNSET;
+        }
+        if (count + unset <= c->bound) {
+            continue;
+        }
+        // Constraint is closer to propagation with fewer TRUE literals missing
+        for (size_t j = 0; j < c->size; ++j) {
+            if (get(t, c->lits[j]) == UNSET) {
+                int32_t var = c->lits[j] > 0 ? c->lits[j] : -c->lits[j];
+                score[var] += 1.0 / (1 + c->bound - count);
+            }
+        }
+    }
+}
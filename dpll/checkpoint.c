@@ -0,0 +1,291 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <assert.h>
+#include <time.h>
+#include <zlib.h>
+#include "dpll.h"
+
+// Checkpoint file, gzip compressed, all numbers little endian as in memory:
+//   magic "DPLLCKP1", formula fingerprint, n_vars
+//   decisions, propagations, conflicts, restarts_done, restart_limit, learned, seed
+//   order[n_vars] (int32), has_phase (u64) and packed phase if set
+//   stack_size, then per frame: depth (u64), dec (int32), packed interpretation
+//   path length and path (int32)
+//   extra_size, then per clause: size (u64) and literals (int32)
+// Interpretations take 2 bits per variable; every frame is stored xor-ed with the previous one,
+// frames share most of their values, so the difference compresses to almost nothing
+#define CHECKPOINT_MAGIC "DPLLCKP1"
+
+static double START;              // start of this run, 0 before first terminate call
+static double LAST;               // time of last periodic checkpoint
+static uint64_t START_CONFLICTS;  // conflicts of resumed runs are not counted into budget
+
+static double
+checkpoint_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint64_t
+fp_mix(uint64_t h, uint64_t x) {
+    h ^= x + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+    return h * 0xbf58476d1ce4e5b9ull;
+}
+
+// Returns hash of everything search depends on, resumed formula must be the same
+static uint64_t
+checkpoint_fingerprint(const Solver *s) {
+    const Formula *f = s->f;
+    uint64_t h = fp_mix(0, f->n_vars);
+    for (size_t i = 0; i < f->n_clauses; ++i) {
+        h = fp_mix(h, f->clauses[i].size);
+        for (size_t j = 0; j < f->clauses[i].size; ++j) {
+            h = fp_mix(h, (uint32_t)f->clauses[i].lits[j]);
+        }
+    }
+    if (f->imp) {
+        for (int32_t lit = -(int32_t)f->n_vars; lit <= (int32_t)f->n_vars; ++lit) {
+            for (size_t k = f->imp_start[lit]; k < f->imp_start[lit + 1]; ++k) {
+                h = fp_mix(h, (uint64_t)(uint32_t)lit << 32 | (uint32_t)f->imp[k]);
+            }
+        }
+    }
+    for (size_t i = 0; i < f->n_xors; ++i) {
+        h = fp_mix(h, f->xors[i].rhs);
+        for (size_t j = 0; j < f->xors[i].size; ++j) {
+            h = fp_mix(h, f->xors[i].vars[j]);
+        }
+    }
+    for (size_t i = 0; i < f->n_cards; ++i) {
+        h = fp_mix(h, f->cards[i].bound);
+        for (size_t j = 0; j < f->cards[i].size; ++j) {
+            h = fp_mix(h, (uint32_t)f->cards[i].lits[j]);
+        }
+    }
+    for (int32_t v = 1; v <= (int32_t)s->n_vars; ++v) {
+        h = fp_mix(h, get(s->root, v));
+    }
+    return h;
+}
+
+static void
+pack(Tetrits t, size_t n_vars, unsigned char *out) {
+    memset(out, 0, (n_vars + 3) / 4);
+    for (size_t v = 1; v <= n_vars; ++v) {
+        out[(v - 1) / 4] |= get(t, v) << 2 * ((v - 1) % 4);
+    }
+}
+
+static void
+unpack(const unsigned char *in, size_t n_vars, Tetrits t) {
+    memset(t - n_vars, UNSET, 2 * n_vars + 1);
+    for (size_t v = 1; v <= n_vars; ++v) {
+        State val = (in[(v - 1) / 4] >> 2 * ((v - 1) % 4)) & 3;
+        if (val != UNSET) {
+            set(t, val == TRUE ? (int32_t)v : -(int32_t)v);
+        }
+    }
+}
+
+static int
+put(gzFile gz, const void *data, size_t size) {
+    // gzwrite takes unsigned lengths, large arrays go in slices
+    const char *p = data;
+    while (size) {
+        unsigned part = size > (1u << 30) ? 1u << 30 : size;
+        if (gzwrite(gz, p, part) != (int)part) {
+            return 0;
+        }
+        p += part;
+        size -= part;
+    }
+    return 1;
+}
+
+static int
+put64(gzFile gz, uint64_t x) {
+    return put(gz, &x, sizeof(x));
+}
+
+int
+checkpoint_save(const Solver *s, const char *path) {
+    size_t tmp_len = strlen(path) + 5;
+    char *tmp = malloc(tmp_len);
+    snprintf(tmp, tmp_len, "%s.tmp", path);
+    gzFile gz = gzopen(tmp, "wb6");
+    if (!gz) {
+        fprintf(stderr, "c checkpoint: can not open %s\n", tmp);
+        free(tmp);
+        return 0;
+    }
+    size_t bytes = (s->n_vars + 3) / 4;
+    unsigned char *prev = calloc(bytes + 1, 1), *cur = malloc(bytes + 1);
+    int ok = put(gz, CHECKPOINT_MAGIC, 8) && put64(gz, checkpoint_fingerprint(s)) && put64(gz, s->n_vars)
+            && put64(gz, s->decisions) && put64(gz, s->propagations) && put64(gz, s->conflicts)
+            && put64(gz, s->restarts_done) && put64(gz, s->restart_limit) && put64(gz, s->learned)
+            && put64(gz, s->seed) && put(gz, s->order, s->n_vars * sizeof(*s->order))
+            && put64(gz, s->polarity == POL_PHASE);
+    if (ok && s->polarity == POL_PHASE) {
+        pack(s->phase, s->n_vars, cur);
+        ok = put(gz, cur, bytes);
+    }
+    ok = ok && put64(gz, s->stack_size);
+    size_t max_depth = 0;
+    for (size_t i = 0; ok && i < s->stack_size; ++i) {
+        const Frame *fr = s->stack + i;
+        max_depth = fr->depth > max_depth ? fr->depth : max_depth;
+        pack(fr->inter, s->n_vars, cur);
+        for (size_t k = 0; k < bytes; ++k) {
+            prev[k] ^= cur[k];
+        }
+        ok = put64(gz, fr->depth) && put(gz, &fr->dec, sizeof(fr->dec)) && put(gz, prev, bytes);
+        unsigned char *swap = prev;
+        prev = cur;
+        cur = swap;
+    }
+    // Path above the deepest frame is stale, frames below it need their ancestors' decisions
+    ok = ok && put64(gz, max_depth) && put(gz, s->path, max_depth * sizeof(*s->path));
+    ok = ok && put64(gz, s->extra_size);
+    for (size_t i = 0; ok && i < s->extra_size; ++i) {
+        ok = put64(gz, s->extra[i].size) && put(gz, s->extra[i].lits, s->extra[i].size * sizeof(int32_t));
+    }
+    ok = gzclose(gz) == Z_OK && ok;
+    free(prev);
+    free(cur);
+    // Rename replaces the old checkpoint at once, a kill while writing leaves it intact
+    if (!ok || rename(tmp, path) != 0) {
+        fprintf(stderr, "c checkpoint: writing %s failed\n", path);
+        remove(tmp);
+        free(tmp);
+        return 0;
+    }
+    fprintf(stderr, "c checkpoint: %s at %lu conflicts, %lu frames, %lu learned clauses\n",
+            path, s->conflicts, s->stack_size, s->extra_size);
+    free(tmp);
+    return 1;
+}
+
+static void
+get_or_die(gzFile gz, void *data, size_t size, const char *path) {
+    char *p = data;
+    while (size) {
+        unsigned part = size > (1u << 30) ? 1u << 30 : size;
+        if (gzread(gz, p, part) != (int)part) {
+            fprintf(stderr, "Checkpoint %s is truncated or corrupt\n", path);
+            exit(1);
+        }
+        p += part;
+        size -= part;
+    }
+}
+
+static uint64_t
+get64(gzFile gz, const char *path) {
+    uint64_t x;
+    get_or_die(gz, &x, sizeof(x), path);
+    return x;
+}
+
+void
+checkpoint_load(Solver *s, const char *path) {
+    gzFile gz = gzopen(path, "rb");
+    if (!gz) {
+        perror(path);
+        exit(1);
+    }
+    char magic[8];
+    get_or_die(gz, magic, 8, path);
+    if (memcmp(magic, CHECKPOINT_MAGIC, 8)) {
+        fprintf(stderr, "Checkpoint %s: not a checkpoint file\n", path);
+        exit(1);
+    }
+    if (get64(gz, path) != checkpoint_fingerprint(s) || get64(gz, path) != s->n_vars) {
+        fprintf(stderr, "Checkpoint %s: formula or preprocessing options differ\n", path);
+        exit(1);
+    }
+    s->decisions = get64(gz, path);
+    s->propagations = get64(gz, path);
+    s->conflicts = get64(gz, path);
+    s->restarts_done = get64(gz, path);
+    s->restart_limit = get64(gz, path);
+    s->learned = get64(gz, path);
+    s->seed = get64(gz, path);
+    get_or_die(gz, s->order, s->n_vars * sizeof(*s->order), path);
+    size_t bytes = (s->n_vars + 3) / 4;
+    unsigned char *packed = calloc(bytes + 1, 1), *delta = malloc(bytes + 1);
+    if (get64(gz, path)) {
+        // Phase is owned by the caller, as with local search
+        get_or_die(gz, delta, bytes, path);
+        if (!s->phase) {
+            s->phase = tetrits_alloc(s->n_vars);
+        }
+        unpack(delta, s->n_vars, s->phase);
+        s->polarity = POL_PHASE;
+    }
+    s->stack_size = get64(gz, path);
+    if (s->stack_size == 0 || s->stack_size > s->n_vars + 1) {
+        fprintf(stderr, "Checkpoint %s is truncated or corrupt\n", path);
+        exit(1);
+    }
+    for (size_t i = 0; i < s->stack_size; ++i) {
+        Frame *fr = s->stack + i;
+        fr->depth = get64(gz, path);
+        get_or_die(gz, &fr->dec, sizeof(fr->dec), path);
+        get_or_die(gz, delta, bytes, path);
+        for (size_t k = 0; k < bytes; ++k) {
+            packed[k] ^= delta[k];
+        }
+        if (!fr->inter) {
+            fr->inter = tetrits_alloc(s->n_vars);
+        }
+        unpack(packed, s->n_vars, fr->inter);
+    }
+    free(packed);
+    free(delta);
+    size_t depth = get64(gz, path);
+    if (depth > s->n_vars) {
+        fprintf(stderr, "Checkpoint %s is truncated or corrupt\n", path);
+        exit(1);
+    }
+    free(s->path);
+    s->path = calloc(s->n_vars + 1, sizeof(*s->path));
+    get_or_die(gz, s->path, depth * sizeof(*s->path), path);
+    size_t n_extra = get64(gz, path);
+    for (size_t i = 0; i < n_extra; ++i) {
+        size_t size = get64(gz, path);
+        if (size > s->n_vars) {
+            fprintf(stderr, "Checkpoint %s is truncated or corrupt\n", path);
+            exit(1);
+        }
+        int32_t *lits = malloc((size ? size : 1) * sizeof(*lits));
+        get_or_die(gz, lits, size * sizeof(*lits), path);
+        solver_add_extra(s, lits, size);
+        free(lits);
+    }
+    gzclose(gz);
+    s->resumed = 1;
+    fprintf(stderr, "c checkpoint: resumed %s at %lu conflicts, %lu frames, %lu learned clauses\n",
+            path, s->conflicts, s->stack_size, s->extra_size);
+}
+
+int
+checkpoint_terminate(void *data) {
+    Solver *s = data;
+    double now = checkpoint_now();
+    if (START == 0) {
+        START = LAST = now;
+        START_CONFLICTS = s->conflicts;
+    }
+    if ((TIME_LIMIT > 0 && now - START >= TIME_LIMIT)
+            || (CONFLICT_LIMIT > 0 && s->conflicts - START_CONFLICTS >= CONFLICT_LIMIT)) {
+        return 1;
+    }
+    if (CHECKPOINT && CHECKPOINT_INTERVAL > 0 && now - LAST >= CHECKPOINT_INTERVAL) {
+        checkpoint_save(s, CHECKPOINT);
+        LAST = now;
+    }
+    return 0;
+}
@@ -0,0 +1,602 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <assert.h>
+#include "dpll.h"
+
+// Counting tuning
+#define COUNT_CACHE_BYTES (1ull << 30)  // component cache size, least recently used half is evicted above it
+#define COUNT_BUCKETS_MIN 4096
+
+// Unsigned arbitrary precision number, little-endian base 2^32 limbs, zero has no limbs
+typedef struct Big {
+    size_t size;
+    size_t cap;
+    uint32_t *limbs;
+} Big;
+
+// Cached count of a component, keyed by its sorted variables and sorted clause indexes
+typedef struct Entry {
+    struct Entry *next;
+    uint64_t hash;
+    uint64_t stamp;      // last use
+    size_t key_size;
+    uint32_t *key;
+    Big count;
+} Entry;
+
+// Connected part of the residual formula: unassigned variables and unsatisfied clauses over them
+typedef struct Comp {
+    size_t n_vars;
+    size_t n_clauses;
+    int32_t *vars;
+    uint32_t *clauses;
+    char exist;          // no projected variable, only satisfiability matters
+} Comp;
+
+static const Formula *F;
+static size_t N;
+static char *VAL;          // value by variable
+static int32_t *TRAIL;     // assigned literals
+static size_t TRAIL_SIZE;
+static size_t *OCC_START;  // clauses by literal in CSR form, indexed by lit + N
+static uint32_t *OCC;
+static char *PROJ;         // projected variables, all of them without projection
+static uint64_t *VAR_STAMP;
+static uint64_t *CLAUSE_STAMP;
+static uint64_t STAMP;
+static uint32_t *SCORE;    // occurrences of variable in unsatisfied clauses of its component
+static Entry **BUCKETS;
+static size_t N_BUCKETS, N_ENTRIES;
+static size_t CACHE_BYTES;
+static uint64_t CLOCK;
+static uint64_t HITS, MISSES, EVICTED, BRANCHES, CONFLICTS;
+static Stats *STATS;
+
+static void
+big_reserve(Big *a, size_t cap) {
+    if (a->cap < cap) {
+        a->cap = cap;
+        a->limbs = realloc(a->limbs, cap * sizeof(*a->limbs));
+    }
+}
+
+static void
+big_set(Big *a, uint32_t x) {
+    big_reserve(a, 1);
+    a->limbs[0] = x;
+    a->size = x != 0;
+}
+
+static void
+big_copy(Big *dst, const Big *src) {
+    big_reserve(dst, src->size);
+    // Zero may have no limbs allocated
+    if (src->size) {
+        memcpy(dst->limbs, src->limbs, src->size * sizeof(*src->limbs));
+    }
+    dst->size = src->size;
+}
+
+static void
+big_add(Big *a, const Big *b) {
+    size_t size = a->size > b->size ? a->size : b->size;
+    big_reserve(a, size + 1);
+    uint64_t carry = 0;
+    for (size_t i = 0; i < size; ++i) {
+        carry += (uint64_t)(i < a->size ? a->limbs[i] : 0) + (i < b->size ? b->limbs[i] : 0);
+        a->limbs[i] = (uint32_t)carry;
+        carry >>= 32;
+    }
+    a->size = size;
+    if (carry) {
+        a->limbs[a->size++] = (uint32_t)carry;
+    }
+}
+
+static void
+big_mul(Big *a, const Big *b) {
+    if (!a->size || !b->size) {
+        a->size = 0;
+        return;
+    }
+    size_t size = a->size + b->size;
+    uint32_t *res = calloc(size, sizeof(*res));
+    for (size_t i = 0; i < a->size; ++i) {
+        uint64_t carry = 0;
+        for (size_t j = 0; j < b->size; ++j) {
+            carry += (uint64_t)a->limbs[i] * b->limbs[j] + res[i + j];
+            res[i + j] = (uint32_t)carry;
+            carry >>= 32;
+        }
+        res[i + b->size] = (uint32_t)carry;
+    }
+    free(a->limbs);
+    a->limbs = res;
+    a->cap = size;
+    while (size && !res[size - 1]) {
+        size--;
+    }
+    a->size = size;
+}
+
+// Desc: multiply by 2^bits
+static void
+big_shl(Big *a, size_t bits) {
+    if (!a->size || !bits) {
+        return;
+    }
+    size_t words = bits / 32, shift = bits % 32;
+    big_reserve(a, a->size + words + 1);
+    a->limbs[a->size + words] = 0;
+    for (size_t i = a->size; i-- > 0;) {
+        uint64_t x = (uint64_t)a->limbs[i] << shift;
+        a->limbs[i + words + 1] |= (uint32_t)(x >> 32);
+        a->limbs[i + words] = (uint32_t)x;
+    }
+    memset(a->limbs, 0, words * sizeof(*a->limbs));
+    a->size += words + 1;
+    while (a->size && !a->limbs[a->size - 1]) {
+        a->size--;
+    }
+}
+
+// Returns decimal digits, freed by free()
+static char *
+big_string(const Big *a) {
+    char *out = malloc(a->size * 10 + 2);
+    uint32_t *tmp = malloc((a->size ? a->size : 1) * sizeof(*tmp));
+    memcpy(tmp, a->limbs, a->size * sizeof(*tmp));
+    size_t size = a->size, n = 0;
+    do {
+        // Divide by 10^9, remainder is nine digits
+        uint64_t rem = 0;
+        for (size_t i = size; i-- > 0;) {
+            uint64_t cur = (rem << 32) | tmp[i];
+            tmp[i] = (uint32_t)(cur / 1000000000u);
+            rem = cur % 1000000000u;
+        }
+        while (size && !tmp[size - 1]) {
+            size--;
+        }
+        for (int d = 0; d < 9 && (size || rem); ++d) {
+            out[n++] = '0' + rem % 10;
+            rem /= 10;
+        }
+    } while (size);
+    if (!n) {
+        out[n++] = '0';
+    }
+    for (size_t i = 0; i < n / 2; ++i) {
+        char c = out[i];
+        out[i] = out[n - 1 - i];
+        out[n - 1 - i] = c;
+    }
+    out[n] = 0;
+    free(tmp);
+    return out;
+}
+
+static State
+lit_value(int32_t lit) {
+    State v = VAL[lit > 0 ? lit : -lit];
+    if (v == UNSET || lit > 0) {
+        return v;
+    }
+    return v == TRUE ? FALSE : TRUE;
+}
+
+static void
+count_assign(int32_t lit) {
+    VAL[lit > 0 ? lit : -lit] = lit > 0 ? TRUE : FALSE;
+    TRAIL[TRAIL_SIZE++] = lit;
+}
+
+// Desc: assign lit and propagate units through clauses containing negations of assigned literals
+// Returns 0 on conflict
+static int
+count_propagate(int32_t lit) {
+    if (lit_value(lit) != UNSET) {
+        return lit_value(lit) == TRUE;
+    }
+    size_t head = TRAIL_SIZE;
+    count_assign(lit);
+    while (head < TRAIL_SIZE) {
+        int32_t neg = -TRAIL[head++];
+        for (size_t k = OCC_START[neg + N]; k < OCC_START[neg + N + 1]; ++k) {
+            const Clause *c = F->clauses + OCC[k];
+            size_t unset = 0;
+            int32_t unit = 0;
+            for (size_t j = 0; j < c->size; ++j) {
+                State v = lit_value(c->lits[j]);
+                if (v == TRUE) {
+                    goto NEXT_CLAUSE;
+                }
+                if (v == UNSET) {
+                    unset++;
+                    unit = c->lits[j];
+                }
+            }
+            if (unset == 0) {
+                return 0;
+            }
+            if (unset == 1) {
+                count_assign(unit);
+            }
+NEXT_CLAUSE:;
+        }
+    }
+    return 1;
+}
+
+static void
+count_undo(size_t mark) {
+    while (TRAIL_SIZE > mark) {
+        int32_t lit = TRAIL[--TRAIL_SIZE];
+        VAL[lit > 0 ? lit : -lit] = UNSET;
+    }
+}
+
+static int
+clause_satisfied(const Clause *c) {
+    for (size_t j = 0; j < c->size; ++j) {
+        if (lit_value(c->lits[j]) == TRUE) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int
+u32_cmp(const void *l, const void *r) {
+    uint32_t a = *(const uint32_t *)l, b = *(const uint32_t *)r;
+    return (a > b) - (a < b);
+}
+
+// Desc: split unassigned variables of vars into components of the residual formula
+// Returns components, their number in n_comps; *n_free is number of projected variables without clauses
+static Comp *
+count_decompose(const int32_t *vars, size_t n, size_t *n_comps, size_t *n_free) {
+    Comp *comps = NULL;
+    size_t cap = 0;
+    *n_comps = *n_free = 0;
+    STAMP++;
+    for (size_t i = 0; i < n; ++i) {
+        int32_t v = vars[i];
+        if (VAL[v] != UNSET || VAR_STAMP[v] == STAMP) {
+            continue;
+        }
+        // Breadth first search over unsatisfied clauses, component variables are the queue
+        Comp c = {0};
+        size_t vars_cap = 16, clauses_cap = 16;
+        c.vars = malloc(vars_cap * sizeof(*c.vars));
+        c.clauses = malloc(clauses_cap * sizeof(*c.clauses));
+        c.vars[c.n_vars++] = v;
+        VAR_STAMP[v] = STAMP;
+        SCORE[v] = 0;
+        for (size_t q = 0; q < c.n_vars; ++q) {
+            int32_t u = c.vars[q];
+            for (int pol = 0; pol < 2; ++pol) {
+                int32_t lit = pol ? -u : u;
+                for (size_t k = OCC_START[lit + N]; k < OCC_START[lit + N + 1]; ++k) {
+                    uint32_t ci = OCC[k];
+                    if (CLAUSE_STAMP[ci] == STAMP) {
+                        continue;
+                    }
+                    CLAUSE_STAMP[ci] = STAMP;
+                    const Clause *cl = F->clauses + ci;
+                    if (clause_satisfied(cl)) {
+                        continue;
+                    }
+                    if (c.n_clauses == clauses_cap) {
+                        clauses_cap *= 2;
+                        c.clauses = realloc(c.clauses, clauses_cap * sizeof(*c.clauses));
+                    }
+                    c.clauses[c.n_clauses++] = ci;
+                    for (size_t j = 0; j < cl->size; ++j) {
+                        int32_t w = cl->lits[j] > 0 ? cl->lits[j] : -cl->lits[j];
+                        if (VAL[w] != UNSET) {
+                            continue;
+                        }
+                        if (VAR_STAMP[w] != STAMP) {
+                            VAR_STAMP[w] = STAMP;
+                            SCORE[w] = 0;
+                            if (c.n_vars == vars_cap) {
+                                vars_cap *= 2;
+                                c.vars = realloc(c.vars, vars_cap * sizeof(*c.vars));
+                            }
+                            c.vars[c.n_vars++] = w;
+                        }
+                        SCORE[w]++;
+                    }
+                }
+            }
+        }
+        if (!c.n_clauses) {
+            *n_free += PROJ[v];
+            free(c.vars);
+            free(c.clauses);
+            continue;
+        }
+        c.exist = 1;
+        for (size_t k = 0; k < c.n_vars && c.exist; ++k) {
+            c.exist = !PROJ[c.vars[k]];
+        }
+        if (*n_comps == cap) {
+            cap = cap ? 2 * cap : 4;
+            comps = realloc(comps, cap * sizeof(*comps));
+        }
+        comps[(*n_comps)++] = c;
+    }
+    return comps;
+}
+
+static uint64_t
+key_hash(const uint32_t *key, size_t size) {
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < size; ++i) {
+        h = (h ^ key[i]) * 0x100000001b3ull;
+        h ^= h >> 29;
+    }
+    return h;
+}
+
+static size_t
+entry_bytes(const Entry *e) {
+    return sizeof(*e) + e->key_size * sizeof(*e->key) + e->count.cap * sizeof(*e->count.limbs);
+}
+
+static int
+entry_stamp_cmp(const void *l, const void *r) {
+    uint64_t a = (*(Entry *const *)l)->stamp, b = (*(Entry *const *)r)->stamp;
+    return (a > b) - (a < b);
+}
+
+// Desc: drop the least recently used half of the cache
+static void
+cache_evict(void) {
+    Entry **all = malloc(N_ENTRIES * sizeof(*all));
+    size_t n = 0;
+    for (size_t b = 0; b < N_BUCKETS; ++b) {
+        for (Entry *e = BUCKETS[b]; e; e = e->next) {
+            all[n++] = e;
+        }
+        BUCKETS[b] = NULL;
+    }
+    qsort(all, n, sizeof(*all), entry_stamp_cmp);
+    for (size_t i = 0; i < n / 2; ++i) {
+        CACHE_BYTES -= entry_bytes(all[i]);
+        free(all[i]->key);
+        free(all[i]->count.limbs);
+        free(all[i]);
+    }
+    EVICTED += n / 2;
+    N_ENTRIES = 0;
+    for (size_t i = n / 2; i < n; ++i) {
+        Entry *e = all[i];
+        size_t b = e->hash & (N_BUCKETS - 1);
+        e->next = BUCKETS[b];
+        BUCKETS[b] = e;
+        N_ENTRIES++;
+    }
+    free(all);
+}
+
+static Entry *
+cache_find(const uint32_t *key, size_t size, uint64_t hash) {
+    for (Entry *e = BUCKETS[hash & (N_BUCKETS - 1)]; e; e = e->next) {
+        if (e->hash == hash && e->key_size == size && !memcmp(e->key, key, size * sizeof(*key))) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+// Desc: store count, key is taken over
+static void
+cache_store(uint32_t *key, size_t size, uint64_t hash, const Big *count) {
+    if (N_ENTRIES >= N_BUCKETS) {
+        // Rehash into twice as many buckets
+        Entry **old = BUCKETS;
+        size_t old_n = N_BUCKETS;
+        N_BUCKETS *= 2;
+        BUCKETS = calloc(N_BUCKETS, sizeof(*BUCKETS));
+        for (size_t b = 0; b < old_n; ++b) {
+            for (Entry *e = old[b], *next; e; e = next) {
+                next = e->next;
+                e->next = BUCKETS[e->hash & (N_BUCKETS - 1)];
+                BUCKETS[e->hash & (N_BUCKETS - 1)] = e;
+            }
+        }
+        free(old);
+    }
+    Entry *e = calloc(1, sizeof(*e));
+    e->hash = hash;
+    e->stamp = ++CLOCK;
+    e->key = key;
+    e->key_size = size;
+    big_copy(&e->count, count);
+    size_t b = hash & (N_BUCKETS - 1);
+    e->next = BUCKETS[b];
+    BUCKETS[b] = e;
+    N_ENTRIES++;
+    CACHE_BYTES += entry_bytes(e);
+    if (CACHE_BYTES > COUNT_CACHE_BYTES) {
+        cache_evict();
+    }
+}
+
+static void
+count_residual(const int32_t *vars, size_t n, Big *out);
+
+// Desc: count models of component, projected on PROJ; counts of components without projected
+// variables are 1 if satisfiable, else 0. Result is not exact if STOP is set
+static void
+count_comp(const Comp *c, Big *out) {
+    // Key: variables, separator, clauses
+    size_t key_size = c->n_vars + 1 + c->n_clauses;
+    uint32_t *key = malloc(key_size * sizeof(*key));
+    for (size_t i = 0; i < c->n_vars; ++i) {
+        key[i] = c->vars[i];
+    }
+    qsort(key, c->n_vars, sizeof(*key), u32_cmp);
+    key[c->n_vars] = 0;
+    memcpy(key + c->n_vars + 1, c->clauses, c->n_clauses * sizeof(*key));
+    qsort(key + c->n_vars + 1, c->n_clauses, sizeof(*key), u32_cmp);
+    uint64_t hash = key_hash(key, key_size);
+    Entry *hit = cache_find(key, key_size, hash);
+    if (hit) {
+        HITS++;
+        hit->stamp = ++CLOCK;
+        big_copy(out, &hit->count);
+        free(key);
+        return;
+    }
+    MISSES++;
+
+    // Branch on the variable with most occurrences, projected one if there is any.
+    // Scores of c stay valid until its branches decompose it again
+    int32_t best = 0;
+    for (size_t i = 0; i < c->n_vars; ++i) {
+        int32_t v = c->vars[i];
+        if ((c->exist || PROJ[v]) && (!best || SCORE[v] > SCORE[best])) {
+            best = v;
+        }
+    }
+    big_set(out, 0);
+    Big sub = {0};
+    for (int pol = 0; pol < 2; ++pol) {
+        if (atomic_load_explicit(&STOP, memory_order_relaxed)) {
+            break;
+        }
+        size_t mark = TRAIL_SIZE;
+        BRANCHES++;
+        if (count_propagate(pol ? -best : best)) {
+            count_residual(c->vars, c->n_vars, &sub);
+            big_add(out, &sub);
+        } else {
+            CONFLICTS++;
+        }
+        count_undo(mark);
+        if (c->exist && out->size) {
+            break;
+        }
+    }
+    if (STATS) {
+        atomic_store_explicit(&STATS->decisions, BRANCHES, memory_order_relaxed);
+        atomic_store_explicit(&STATS->conflicts, CONFLICTS, memory_order_relaxed);
+        atomic_store_explicit(&STATS->depth, TRAIL_SIZE, memory_order_relaxed);
+    }
+    free(sub.limbs);
+    if (atomic_load_explicit(&STOP, memory_order_relaxed)) {
+        free(key);
+        return;
+    }
+    cache_store(key, key_size, hash, out);
+}
+
+// Desc: count models of the residual formula over unassigned variables of vars:
+// product of component counts times 2 for every free projected variable
+static void
+count_residual(const int32_t *vars, size_t n, Big *out) {
+    size_t n_comps, n_free;
+    Comp *comps = count_decompose(vars, n, &n_comps, &n_free);
+    big_set(out, 1);
+    big_shl(out, n_free);
+    Big sub = {0};
+    for (size_t i = 0; i < n_comps; ++i) {
+        if (out->size) {
+            count_comp(comps + i, &sub);
+            big_mul(out, &sub);
+        }
+        free(comps[i].vars);
+        free(comps[i].clauses);
+    }
+    free(sub.limbs);
+    free(comps);
+}
+
+char *
+count_solve(const Formula *f, Stats *stats) {
+    F = f;
+    N = f->n_vars;
+    STATS = stats;
+    VAL = calloc(N + 1, sizeof(*VAL));
+    TRAIL = malloc((N + 1) * sizeof(*TRAIL));
+    TRAIL_SIZE = 0;
+    PROJ = malloc(N + 1);
+    memset(PROJ, f->n_proj == 0, N + 1);
+    for (size_t i = 0; i < f->n_proj; ++i) {
+        PROJ[f->proj[i]] = 1;
+    }
+    VAR_STAMP = calloc(N + 1, sizeof(*VAR_STAMP));
+    CLAUSE_STAMP = calloc(f->n_clauses + 1, sizeof(*CLAUSE_STAMP));
+    SCORE = calloc(N + 1, sizeof(*SCORE));
+    N_BUCKETS = COUNT_BUCKETS_MIN;
+    BUCKETS = calloc(N_BUCKETS, sizeof(*BUCKETS));
+
+    size_t n = 2 * N + 1;
+    OCC_START = calloc(n + 1, sizeof(*OCC_START));
+    for (size_t ci = 0; ci < f->n_clauses; ++ci) {
+        for (size_t j = 0; j < f->clauses[ci].size; ++j) {
+            OCC_START[f->clauses[ci].lits[j] + N + 1]++;
+        }
+    }
+    for (size_t i = 0; i < n; ++i) {
+        OCC_START[i + 1] += OCC_START[i];
+    }
+    OCC = malloc((OCC_START[n] ? OCC_START[n] : 1) * sizeof(*OCC));
+    size_t *fill = malloc(n * sizeof(*fill));
+    memcpy(fill, OCC_START, n * sizeof(*fill));
+    for (size_t ci = 0; ci < f->n_clauses; ++ci) {
+        for (size_t j = 0; j < f->clauses[ci].size; ++j) {
+            OCC[fill[f->clauses[ci].lits[j] + N]++] = ci;
+        }
+    }
+    free(fill);
+
+    // Units of the input first, empty clause has no models
+    Big total = {0};
+    int conflict = 0;
+    for (size_t ci = 0; ci < f->n_clauses && !conflict; ++ci) {
+        if (f->clauses[ci].size == 0) {
+            conflict = 1;
+        } else if (f->clauses[ci].size == 1) {
+            conflict = !count_propagate(f->clauses[ci].lits[0]);
+        }
+    }
+    if (!conflict) {
+        int32_t *all = malloc((N ? N : 1) * sizeof(*all));
+        for (size_t v = 1; v <= N; ++v) {
+            all[v - 1] = v;
+        }
+        count_residual(all, N, &total);
+        free(all);
+    } else {
+        big_set(&total, 0);
+    }
+    char *res = atomic_load(&STOP) ? NULL : big_string(&total);
+    fprintf(stderr, "c count: %lu branches, %lu conflicts, cache %lu hits, %lu misses, %lu entries, "
+            "%lu evicted, %.1f MB\n", BRANCHES, CONFLICTS, HITS, MISSES, N_ENTRIES, EVICTED, CACHE_BYTES / 1048576.0);
+
+    for (size_t b = 0; b < N_BUCKETS; ++b) {
+        for (Entry *e = BUCKETS[b], *next; e; e = next) {
+            next = e->next;
+            free(e->key);
+            free(e->count.limbs);
+            free(e);
+        }
+    }
+    free(BUCKETS);
+    free(total.limbs);
+    free(VAL);
+    free(TRAIL);
+    free(PROJ);
+    free(VAR_STAMP);
+    free(CLAUSE_STAMP);
+    free(SCORE);
+    free(OCC_START);
+    free(OCC);
+    return res;
+}
@@ -0,0 +1,288 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include "dpll.h"
+
+// Cube-and-conquer tuning
+#define CUBE_SPLIT_CONFLICTS 256   // conflicts in a cube before its open subtree is given to idle worker
+
+typedef struct Cube {
+    int32_t *lits;
+    size_t size;
+} Cube;
+
+// Deque of cubes: owner takes from the back, thieves steal from the front, where cubes are bigger
+typedef struct Deque {
+    pthread_mutex_t lock;
+    Cube *cubes;
+    size_t head;
+    size_t tail;
+    size_t cap;
+} Deque;
+
+typedef struct Worker {
+    pthread_t thread;
+    Solver solver;
+    Tetrits root;
+    Cube cube;
+    Deque deque;
+    uint64_t last_split;
+} Worker;
+
+static Worker *WORKERS;
+static const Formula *FORMULA;
+static Tetrits ROOT;
+// Cubes created and not refuted yet, search is UNSAT when it drops to 0
+static atomic_size_t PENDING;
+static atomic_size_t IDLE;
+static atomic_size_t SPLITS;
+static pthread_mutex_t WINNER_LOCK = PTHREAD_MUTEX_INITIALIZER;
+static Worker *WINNER;
+
+static void
+deque_push(Deque *d, Cube c) {
+    pthread_mutex_lock(&d->lock);
+    if (d->tail == d->cap && d->head > 0) {
+        // Compact before growing
+        memmove(d->cubes, d->cubes + d->head, (d->tail - d->head) * sizeof(*d->cubes));
+        d->tail -= d->head;
+        d->head = 0;
+    }
+    if (d->tail == d->cap) {
+        d->cap = d->cap ? 2 * d->cap : 64;
+        d->cubes = realloc(d->cubes, d->cap * sizeof(*d->cubes));
+    }
+    d->cubes[d->tail++] = c;
+    pthread_mutex_unlock(&d->lock);
+}
+
+// Returns 1 if cube was taken from back (own == 1) or front
+static int
+deque_take(Deque *d, Cube *c, int own) {
+    int res = 0;
+    pthread_mutex_lock(&d->lock);
+    if (d->head < d->tail) {
+        *c = own ? d->cubes[--d->tail] : d->cubes[d->head++];
+        res = 1;
+    }
+    pthread_mutex_unlock(&d->lock);
+    return res;
+}
+
+static Cube
+cube_make(const int32_t *prefix, size_t prefix_size, const int32_t *lits, size_t size) {
+    Cube c = {malloc((prefix_size + size + 1) * sizeof(*c.lits)), prefix_size + size};
+    memcpy(c.lits, prefix, prefix_size * sizeof(*prefix));
+    memcpy(c.lits + prefix_size, lits, size * sizeof(*lits));
+    return c;
+}
+
+// Desc: give the shallowest open sibling of the search away as a new cube, when somebody is idle
+static void
+cube_on_conflict(Solver *s) {
+    Worker *w = s->ctx;
+    if (s->conflicts - w->last_split < CUBE_SPLIT_CONFLICTS || s->stack_size < 2
+            || atomic_load_explicit(&IDLE, memory_order_relaxed) == 0) {
+        return;
+    }
+    w->last_split = s->conflicts;
+    // Sibling of the path node of its depth, path decisions above it are shared
+    Frame *fr = s->stack;
+    Cube c = cube_make(w->cube.lits, w->cube.size, s->path, fr->depth);
+    c.lits[c.size - 1] = fr->dec;
+    atomic_fetch_add(&PENDING, 1);
+    atomic_fetch_add_explicit(&SPLITS, 1, memory_order_relaxed);
+    deque_push(&w->deque, c);
+    // Remove it from the stack, its buffer becomes first free one
+    Tetrits inter = fr->inter;
+    memmove(s->stack, s->stack + 1, (s->stack_size - 1) * sizeof(*s->stack));
+    s->stack_size--;
+    s->stack[s->stack_size].inter = inter;
+}
+
+static int
+cube_get(Worker *w, Cube *c) {
+    if (deque_take(&w->deque, c, 1)) {
+        return 1;
+    }
+    size_t n = THREADS;
+    for (size_t i = 1; i < n; ++i) {
+        if (deque_take(&WORKERS[(w->solver.id + i) % n].deque, c, 0)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void
+cube_win(Worker *w) {
+    pthread_mutex_lock(&WINNER_LOCK);
+    if (!WINNER) {
+        WINNER = w;
+        atomic_store(&STOP, 1);
+    }
+    pthread_mutex_unlock(&WINNER_LOCK);
+}
+
+static void *
+cube_worker(void *arg) {
+    Worker *w = arg;
+    Solver *s = &w->solver;
+    int idle = 0;
+    while (!atomic_load_explicit(&STOP, memory_order_relaxed)) {
+        Cube c;
+        if (!cube_get(w, &c)) {
+            if (atomic_load(&PENDING) == 0) {
+                break;
+            }
+            if (!idle) {
+                idle = 1;
+                atomic_fetch_add(&IDLE, 1);
+            }
+            sched_yield();
+            continue;
+        }
+        if (idle) {
+            idle = 0;
+            atomic_fetch_sub(&IDLE, 1);
+        }
+        // Assumptions of the cube are fixed in the root of the solver
+        w->cube = c;
+        tetrits_copy(ROOT, w->root, FORMULA->n_vars);
+        for (size_t i = 0; i < c.size; ++i) {
+            set(w->root, c.lits[i]);
+        }
+        w->last_split = s->conflicts;
+        SolverRes res = solver_run(s);
+        if (res == SAT) {
+            cube_win(w);
+        } else if (res == UNSAT) {
+            atomic_fetch_sub(&PENDING, 1);
+        }
+        free(c.lits);
+        w->cube.lits = NULL;
+    }
+    if (idle) {
+        atomic_fetch_sub(&IDLE, 1);
+    }
+    return NULL;
+}
+
+// Desc: enumerate cubes of up to CUBE_DEPTH decisions below frames[depth], refuted ones are dropped
+// Returns 1 if model was found, it is left in frames[depth]
+static int
+cube_generate(Solver *s, Frame *frames, size_t depth, int32_t *lits, size_t *n_cubes) {
+    Frame *fr = frames + depth;
+    int32_t p = 0;
+    while (!p) {
+        SolverRes res = prop_one(s, fr);
+        if (res == SAT) {
+            return 1;
+        } else if (res == UNSAT) {
+            return 0;
+        }
+        if (depth == CUBE_DEPTH) {
+            deque_push(&WORKERS[*n_cubes % THREADS].deque, cube_make(lits, depth, lits, 0));
+            (*n_cubes)++;
+            return 0;
+        }
+        p = calc_param(s, *fr);
+    }
+    for (int branch = 0; branch < 2; ++branch) {
+        lits[depth] = branch ? -p : p;
+        tetrits_copy(fr->inter, frames[depth + 1].inter, s->n_vars);
+        set(frames[depth + 1].inter, lits[depth]);
+        if (cube_generate(s, frames, depth + 1, lits, n_cubes)) {
+            tetrits_copy(frames[depth + 1].inter, fr->inter, s->n_vars);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+SolverRes
+cube_solve(const Formula *f, Tetrits root, Tetrits model) {
+    FORMULA = f;
+    ROOT = root;
+    WORKERS = calloc(THREADS, sizeof(*WORKERS));
+    for (size_t i = 0; i < THREADS; ++i) {
+        pthread_mutex_init(&WORKERS[i].deque.lock, NULL);
+    }
+
+    // Cubes are generated by the same heuristic which is used in the search
+    Solver gen;
+    solver_init(&gen, f, 0, root);
+    gen.heuristic = HEURISTIC;
+    size_t depth = CUBE_DEPTH < f->n_vars ? CUBE_DEPTH : f->n_vars;
+    CUBE_DEPTH = depth;
+    Frame *frames = calloc(depth + 1, sizeof(*frames));
+    for (size_t i = 0; i <= depth; ++i) {
+        frames[i].inter = tetrits_alloc(f->n_vars);
+    }
+    tetrits_copy(root, frames[0].inter, f->n_vars);
+    int32_t *lits = calloc(depth + 1, sizeof(*lits));
+    size_t n_cubes = 0;
+    int sat = cube_generate(&gen, frames, 0, lits, &n_cubes);
+    if (sat) {
+        tetrits_copy(frames[0].inter, model, f->n_vars);
+    }
+    for (size_t i = 0; i <= depth; ++i) {
+        tetrits_free(frames[i].inter, f->n_vars);
+    }
+    free(frames);
+    free(lits);
+    solver_free(&gen);
+
+    SolverRes res = sat ? SAT : UNSAT;
+    if (!sat && n_cubes) {
+        atomic_store(&PENDING, n_cubes);
+        // Workers do not exchange clauses: learned ones hold only under cube assumptions
+        for (size_t i = 0; i < THREADS; ++i) {
+            Worker *w = WORKERS + i;
+            w->root = tetrits_alloc(f->n_vars);
+            solver_init(&w->solver, f, i, w->root);
+            w->solver.heuristic = HEURISTIC;
+            if (PHASE) {
+                w->solver.polarity = POL_PHASE;
+                w->solver.phase = PHASE;
+            }
+            w->solver.stop = &STOP;
+            w->solver.stats = stats_alloc();
+            w->solver.on_conflict = cube_on_conflict;
+            w->solver.ctx = w;
+            if (pthread_create(&w->thread, NULL, cube_worker, w)) {
+                fprintf(stderr, "Failed to start thread %lu\n", i);
+                exit(1);
+            }
+        }
+        for (size_t i = 0; i < THREADS; ++i) {
+            pthread_join(WORKERS[i].thread, NULL);
+        }
+        if (WINNER) {
+            res = SAT;
+            tetrits_copy(solver_model(&WINNER->solver), model, f->n_vars);
+        } else if (atomic_load(&PENDING)) {
+            // Interrupted
+            res = UNKNOWN;
+        }
+        for (size_t i = 0; i < THREADS; ++i) {
+            solver_free(&WORKERS[i].solver);
+            tetrits_free(WORKERS[i].root, f->n_vars);
+        }
+    }
+    fprintf(stderr, "c cubes: %lu generated, %lu split\n", n_cubes, atomic_load(&SPLITS));
+    for (size_t i = 0; i < THREADS; ++i) {
+        Deque *d = &WORKERS[i].deque;
+        for (size_t j = d->head; j < d->tail; ++j) {
+            free(d->cubes[j].lits);
+        }
+        free(d->cubes);
+        pthread_mutex_destroy(&d->lock);
+    }
+    free(WORKERS);
+    return res;
+}
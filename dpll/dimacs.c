@@ -0,0 +1,392 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <zlib.h>
+#include <lzma.h>
+#include "dpll.h"
+
+typedef struct Input {
+    const char *data;
+    size_t size;
+    void *mapped;  // mmap-ed region to unmap, NULL if data is malloc-ed
+} Input;
+
+static void
+dimacs_error(const char *msg, const char *p, const Input *in) {
+    size_t line = 1;
+    for (const char *i = in->data; i < p; ++i) {
+        line += *i == '\n';
+    }
+    fprintf(stderr, "DIMACS error at line %lu: %s\n", line, msg);
+    exit(1);
+}
+
+// Desc: map file into memory, read whole input if it can not be mapped (pipe)
+static Input
+input_open(const char *path) {
+    Input in = {NULL, 0, NULL};
+    int fd = path ? open(path, O_RDONLY) : 0;
+    if (fd < 0) {
+        perror(path);
+        exit(1);
+    }
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        in.mapped = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (in.mapped != MAP_FAILED) {
+            madvise(in.mapped, st.st_size, MADV_SEQUENTIAL);
+            in.data = in.mapped;
+            in.size = st.st_size;
+            if (path) {
+                close(fd);
+            }
+            return in;
+        }
+        in.mapped = NULL;
+    }
+    size_t cap = 1 << 20;
+    char *buf = malloc(cap);
+    ssize_t got;
+    while ((got = read(fd, buf + in.size, cap - in.size)) > 0) {
+        in.size += got;
+        if (in.size == cap) {
+            cap *= 2;
+            buf = realloc(buf, cap);
+            assert(buf);
+        }
+    }
+    if (path) {
+        close(fd);
+    }
+    in.data = buf;
+    return in;
+}
+
+static void
+input_close(Input *in) {
+    if (in->mapped) {
+        munmap(in->mapped, in->size);
+    } else {
+        free((char *)in->data);
+    }
+}
+
+// Desc: replace gzip or xz compressed input with its decompressed content
+static void
+input_decompress(Input *in) {
+    const unsigned char *d = (const unsigned char *)in->data;
+    int gzip = in->size >= 2 && d[0] == 0x1f && d[1] == 0x8b;
+    int xz = in->size >= 6 && !memcmp(d, "\xfd" "7zXZ\0", 6);
+    if (!gzip && !xz) {
+        return;
+    }
+    size_t cap = in->size * 4 + (1 << 16), size = 0;
+    char *out = malloc(cap);
+    int ok;
+    if (gzip) {
+        z_stream zs;
+        memset(&zs, 0, sizeof(zs));
+        // 32: gzip header auto-detection
+        ok = inflateInit2(&zs, 15 + 32) == Z_OK;
+        zs.next_in = (unsigned char *)d;
+        size_t left = in->size;
+        while (ok) {
+            // avail_in and avail_out are 32-bit, so huge buffers are passed in slices
+            if (zs.avail_in == 0 && left) {
+                zs.avail_in = left > UINT32_MAX ? UINT32_MAX : left;
+                left -= zs.avail_in;
+            }
+            if (size == cap) {
+                cap *= 2;
+                out = realloc(out, cap);
+            }
+            zs.next_out = (unsigned char *)out + size;
+            zs.avail_out = cap - size > UINT32_MAX ? UINT32_MAX : cap - size;
+            size_t before = zs.avail_out;
+            int res = inflate(&zs, Z_NO_FLUSH);
+            size += before - zs.avail_out;
+            if (res == Z_STREAM_END) {
+                if (zs.avail_in == 0 && !left) {
+                    break;
+                }
+                // Concatenated gzip members
+                ok = inflateReset(&zs) == Z_OK;
+                continue;
+            }
+            // Buffer error with free output space means truncated input
+            ok = res == Z_OK || (res == Z_BUF_ERROR && zs.avail_out == 0);
+        }
+        inflateEnd(&zs);
+    } else {
+        lzma_stream ls = LZMA_STREAM_INIT;
+        ok = lzma_stream_decoder(&ls, UINT64_MAX, LZMA_CONCATENATED) == LZMA_OK;
+        ls.next_in = d;
+        ls.avail_in = in->size;
+        lzma_ret res = LZMA_OK;
+        while (ok && res != LZMA_STREAM_END) {
+            if (size == cap) {
+                cap *= 2;
+                out = realloc(out, cap);
+            }
+            ls.next_out = (uint8_t *)out + size;
+            ls.avail_out = cap - size;
+            res = lzma_code(&ls, LZMA_FINISH);
+            size = cap - ls.avail_out;
+            ok = res == LZMA_OK || res == LZMA_STREAM_END || (res == LZMA_BUF_ERROR && ls.avail_out == 0);
+        }
+        lzma_end(&ls);
+    }
+    if (!ok) {
+        fprintf(stderr, "Failed to decompress %s input\n", gzip ? "gzip" : "xz");
+        exit(1);
+    }
+    input_close(in);
+    in->data = out;
+    in->size = size;
+    in->mapped = NULL;
+}
+
+// Desc: skip comment line, collecting projection variables of "c ind v1 v2 ... 0" lines
+// Returns end of line
+static const char *
+dimacs_comment(Formula *f, const char *p, const char *end, const Input *in) {
+    const char *line = p;
+    if (end - p < 6 || memcmp(p, "c ind ", 6)) {
+        while (p < end && *p != '\n') {
+            p++;
+        }
+        return p;
+    }
+    p += 6;
+    while (p < end && *p != '\n') {
+        if (*p == ' ' || *p == '\t' || *p == '\r') {
+            p++;
+            continue;
+        }
+        uint64_t var = 0;
+        if (*p < '0' || *p > '9') {
+            dimacs_error("projection variable expected", line, in);
+        }
+        while (p < end && *p >= '0' && *p <= '9') {
+            var = var * 10 + (*p++ - '0');
+            if (var >= INT32_MAX) {
+                dimacs_error("projection variable out of range", line, in);
+            }
+        }
+        if (var == 0) {
+            break;
+        }
+        if ((f->n_proj & (f->n_proj - 1)) == 0) {
+            // Size is a power of two, capacity is doubled
+            f->proj = realloc(f->proj, (f->n_proj ? 2 * f->n_proj : 1) * sizeof(*f->proj));
+        }
+        f->proj[f->n_proj++] = var;
+    }
+    while (p < end && *p != '\n') {
+        p++;
+    }
+    return p;
+}
+
+void
+dimacs_load(Formula *f, const char *path) {
+    Input in = input_open(path);
+    input_decompress(&in);
+    const char *p = in.data, *end = in.data + in.size;
+
+    // Comments and header
+    int header = 0;
+    while (p < end && !header) {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) {
+            p++;
+        }
+        if (p == end) {
+            break;
+        }
+        if (*p == 'c') {
+            p = dimacs_comment(f, p, end, &in);
+        } else if (*p == 'p') {
+            unsigned long vars, clauses;
+            char line[128];
+            size_t n = 0;
+            while (p + n < end && p[n] != '\n' && n < sizeof(line) - 1) {
+                line[n] = p[n];
+                n++;
+            }
+            line[n] = 0;
+            if (sscanf(line, "p cnf %lu %lu", &vars, &clauses) != 2) {
+                dimacs_error("bad header", p, &in);
+            }
+            f->n_vars = vars;
+            f->n_clauses = clauses;
+            p += n;
+            header = 1;
+        } else {
+            dimacs_error("header expected", p, &in);
+        }
+    }
+    if (!header) {
+        dimacs_error("no header", p, &in);
+    }
+    if (f->n_vars >= INT32_MAX) {
+        dimacs_error("too many variables", p, &in);
+    }
+
+    // Clauses are written straight into arena, lits pointers are fixed after arena stops growing
+    size_t clauses_cap = f->n_clauses ? f->n_clauses : 1;
+    f->clauses = malloc(clauses_cap * sizeof(*f->clauses));
+    size_t arena_cap = in.size / 2 + 16;
+    f->arena = malloc(arena_cap * sizeof(*f->arena));
+    f->arena_size = 0;
+    size_t n_clauses = 0, start = 0, n_cards = 0;
+    int xor_line = 0;
+    while (p < end) {
+        char ch = *p;
+        if (ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n') {
+            p++;
+            continue;
+        }
+        if (ch == 'c') {
+            p = dimacs_comment(f, p, end, &in);
+            continue;
+        }
+        if (ch == '%') {
+            // SATLIB end marker
+            break;
+        }
+        if (ch == 'x' && start == f->arena_size && !xor_line) {
+            // CryptoMiniSat XOR line: "x1 -2 3 0" is 1 ^ 2 ^ 3 == FALSE
+            xor_line = 1;
+            p++;
+            continue;
+        }
+        if ((ch == '<' || ch == '>') && !xor_line) {
+            // Cardinality line: "1 2 -3 <= 2", or ">= 2" for at least, negations at most the rest
+            if (p + 1 == end || p[1] != '=') {
+                dimacs_error("<= or >= expected", p, &in);
+            }
+            p += 2;
+            while (p < end && (*p == ' ' || *p == '\t')) {
+                p++;
+            }
+            if (p == end || *p < '0' || *p > '9') {
+                dimacs_error("bound expected", p, &in);
+            }
+            uint64_t bound = 0;
+            while (p < end && *p >= '0' && *p <= '9') {
+                bound = bound * 10 + (*p++ - '0');
+                if (bound > INT32_MAX) {
+                    dimacs_error("bound out of range", p, &in);
+                }
+            }
+            size_t size = f->arena_size - start;
+            if (ch == '>') {
+                if (bound > size) {
+                    dimacs_error("bound exceeds number of literals", p, &in);
+                }
+                for (size_t j = start; j < start + size; ++j) {
+                    f->arena[j] = -f->arena[j];
+                }
+                bound = size - bound;
+            }
+            formula_add_card(f, f->arena + start, size, bound);
+            f->arena_size = start;
+            n_cards++;
+            continue;
+        }
+        int neg = 0;
+        if (ch == '-') {
+            neg = 1;
+            p++;
+        }
+        if (p == end || *p < '0' || *p > '9') {
+            dimacs_error("literal expected", p, &in);
+        }
+        uint64_t var = 0;
+        while (p < end && *p >= '0' && *p <= '9') {
+            var = var * 10 + (*p - '0');
+            if (var > f->n_vars) {
+                dimacs_error("variable out of range", p, &in);
+            }
+            p++;
+        }
+        if (var == 0 && xor_line) {
+            formula_add_xor(f, f->arena + start, f->arena_size - start);
+            f->arena_size = start;
+            xor_line = 0;
+            continue;
+        }
+        if (var == 0) {
+            if (n_clauses == clauses_cap) {
+                clauses_cap *= 2;
+                f->clauses = realloc(f->clauses, clauses_cap * sizeof(*f->clauses));
+            }
+            // Offset for now
+            f->clauses[n_clauses].size = f->arena_size - start;
+            f->clauses[n_clauses].lits = (int32_t *)(uintptr_t)start;
+            n_clauses++;
+            start = f->arena_size;
+            continue;
+        }
+        if (f->arena_size == arena_cap) {
+            arena_cap *= 2;
+            f->arena = realloc(f->arena, arena_cap * sizeof(*f->arena));
+        }
+        f->arena[f->arena_size++] = neg ? -(int32_t)var : (int32_t)var;
+    }
+    if (start != f->arena_size || xor_line) {
+        dimacs_error("last clause is not terminated", p, &in);
+    }
+    // XOR and cardinality lines are counted as clauses
+    if (n_clauses + f->n_xors + n_cards != f->n_clauses) {
+        fprintf(stderr, "c warning: header declares %lu clauses, %lu read\n", f->n_clauses,
+                n_clauses + f->n_xors + n_cards);
+    }
+    for (size_t i = 0; i < f->n_proj; ++i) {
+        if ((size_t)f->proj[i] > f->n_vars) {
+            fprintf(stderr, "DIMACS error: projection variable %d out of range\n", f->proj[i]);
+            exit(1);
+        }
+    }
+    f->n_clauses = n_clauses;
+    f->arena = realloc(f->arena, (f->arena_size ? f->arena_size : 1) * sizeof(*f->arena));
+    f->arena_cap = f->arena_size;
+    f->clauses_cap = clauses_cap;
+    for (size_t i = 0; i < f->n_clauses; ++i) {
+        f->clauses[i].lits = f->arena + (uintptr_t)f->clauses[i].lits;
+    }
+    input_close(&in);
+}
+
+void
+dimacs_print_model(Tetrits t, size_t n_vars) {
+    // "v", up to 11 chars per literal, " 0\n"
+    char *buf = malloc(2 + 12 * n_vars + 4);
+    char *p = buf;
+    *p++ = 'v';
+    for (size_t v = 1; v <= n_vars; ++v) {
+        char digits[12];
+        size_t n = 0;
+        for (size_t x = v; x; x /= 10) {
+            digits[n++] = '0' + x % 10;
+        }
+        *p++ = ' ';
+        // Unset variables are don't cares, printed as FALSE
+        if (get(t, v) != TRUE) {
+            *p++ = '-';
+        }
+        while (n) {
+            *p++ = digits[--n];
+        }
+    }
+    memcpy(p, " 0\n", 3);
+    p += 3;
+    fwrite(buf, 1, p - buf, stdout);
+    free(buf);
+}
@@ -3,232 +3,854 @@
 #include <string.h>
 #include <inttypes.h>
 #include <assert.h>
+#ifdef __x86_64__
+#include <immintrin.h>
+#endif
+#include "dpll.h"
 
-typedef struct Clause {
-    size_t size;
-    int16_t *lits;
-} Clause;
+// Look-ahead tuning
+#define LA_CANDIDATES 32        // variables probed per decision
+#define LA_DOUBLE_CANDIDATES 8  // variables probed inside a double look-ahead
+#define LA_DOUBLE_TRIGGER 1.0   // weighted reduction that triggers a double look-ahead
 
-typedef char *Tetrits;
+// Restart tuning
+#define RESTART_UNIT 128        // conflicts per unit of Luby sequence
 
-typedef enum State {
-    TRUE = 1,
-    FALSE = 2,
-    UNSET = 0
-} State;
+// Vectorized clause evaluation
+#define SIMD_MIN_CLAUSE 8       // shorter clauses are evaluated by scalar loop
+#define TETRITS_PADDING 3       // bytes after interpretation read by 32-bit gathers of its last literal
 
-size_t N_VARS;
-size_t N_CLAUSES;
-Clause *CLAUSES;
+Tetrits
+tetrits_alloc(size_t n_vars) {
+    Tetrits t = calloc(2 * n_vars + 1 + TETRITS_PADDING, sizeof(*t));
+    assert(t);
+    return t + n_vars;
+}
 
 void
-tetrits_copy(Tetrits src, Tetrits dst) {
-    memcpy(dst - N_VARS, src - N_VARS, 2* N_VARS + 1);
+tetrits_copy(Tetrits src, Tetrits dst, size_t n_vars) {
+    memcpy(dst - n_vars, src - n_vars, 2 * n_vars + 1);
 }
 
 void
-set(Tetrits t, int16_t ind) {
+tetrits_free(Tetrits t, size_t n_vars) {
+    if (t) {
+        free(t - n_vars);
+    }
+}
+
+void
+set(Tetrits t, int32_t ind) {
     t[ind] = TRUE;
     t[-ind] = FALSE;
 }
 
 State
-get(Tetrits t, int16_t ind) {
+get(Tetrits t, int32_t ind) {
     return t[ind];
 }
 
-typedef struct Frame {
-    Tetrits inter;
-} Frame;   
-
-typedef enum SolverRes {
-    SAT,
-    UNSAT,
-    UNKNOWN
-} SolverRes;
-
-Clause
-clause_init() {
-    Clause res;
-    res.size = 0;
-    res.lits = calloc(N_VARS, sizeof(*res.lits));
-    int16_t cur;
-    (void)! scanf("%"SCNd16, &cur);
-    while (cur != 0) {
-        res.lits[res.size] = cur;
-        res.size++;
-        (void)! scanf("%"SCNd16, &cur);
-    }
-    res.lits = realloc(res.lits, res.size * sizeof(*res.lits));
-    assert(res.lits);
-    return res;
+void
+formula_add(Formula *f, const int32_t *lits, size_t size) {
+    if (f->arena_size + size > f->arena_cap) {
+        // Clauses point into arena, so it is moved by hand
+        size_t cap = 2 * f->arena_cap > f->arena_size + size ? 2 * f->arena_cap : f->arena_size + size + 64;
+        int32_t *arena = malloc(cap * sizeof(*arena));
+        assert(arena);
+        if (f->arena_size) {
+            memcpy(arena, f->arena, f->arena_size * sizeof(*arena));
+        }
+        for (size_t i = 0; i < f->n_clauses; ++i) {
+            f->clauses[i].lits = arena + (f->clauses[i].lits - f->arena);
+        }
+        free(f->arena);
+        f->arena = arena;
+        f->arena_cap = cap;
+    }
+    if (f->n_clauses == f->clauses_cap) {
+        f->clauses_cap = f->clauses_cap ? 2 * f->clauses_cap : 64;
+        f->clauses = realloc(f->clauses, f->clauses_cap * sizeof(*f->clauses));
+    }
+    Clause *c = f->clauses + f->n_clauses++;
+    c->size = size;
+    c->lits = f->arena + f->arena_size;
+    for (size_t i = 0; i < size; ++i) {
+        size_t var = lits[i] > 0 ? lits[i] : -lits[i];
+        f->n_vars = var > f->n_vars ? var : f->n_vars;
+        c->lits[i] = lits[i];
+    }
+    f->arena_size += size;
+}
+
+void
+formula_free(Formula *f) {
+    free(f->arena);
+    free(f->clauses);
+    if (f->imp_start) {
+        free(f->imp_start - f->n_vars);
+    }
+    free(f->imp);
+    for (size_t i = 0; i < f->n_xors; ++i) {
+        free(f->xors[i].vars);
+    }
+    free(f->xors);
+    xor_free(f->gauss);
+    for (size_t i = 0; i < f->n_cards; ++i) {
+        free(f->cards[i].lits);
+    }
+    free(f->cards);
+    free(f->proj);
+    memset(f, 0, sizeof(*f));
 }
 
 // Desc: make step - propagate param of cur frame and all that follows,
 // if SAT returns SAT, else chooses next suggestion, fills stack and returns UNKNOWN
 SolverRes
-solve(Frame *stack, size_t *cur_frame);
+solve(Solver *s);
 
-// Desc: propagate param
-// Returns SAT, UNSAT or UNKNOWN
-SolverRes
-prop_one(Frame *fr);
-
-// Desc: choose param for split using heuristics
-// Returns new param
-int16_t
-calc_param(Frame fr);
-
-int
-main(int argc, char **argv) {
-    char c;
-    (void)! scanf("%c", &c);
-    while (c == 'c') {
-        if (scanf("%*[^\n]%c", &c) == 0) {
-            (void)! scanf("%c", &c);
-        }
-        (void)! scanf("%c", &c);
-    }
-    (void)! scanf(" cnf %lu %lu", &N_VARS, &N_CLAUSES);
-
-    Frame *stack = calloc(N_VARS + 1, sizeof(*stack));
-    stack[0].inter = calloc((N_VARS + 1) * (2 * N_VARS + 1), sizeof(*stack[0].inter)) + N_VARS;
-    for (size_t i = 1; i < N_VARS + 1; ++i) {
-        stack[i].inter = stack[i - 1].inter + 2 * N_VARS + 1;
-    }
-    size_t stack_size = 1;
-    CLAUSES = calloc(N_CLAUSES, sizeof(*CLAUSES));
-
-    size_t clauses_size = 0;
-    for (size_t i = 0; i < N_CLAUSES; ++i) {
-        CLAUSES[i] = clause_init();
-        clauses_size += CLAUSES[i].size;
-    }
-    for (size_t i = 0; i < N_CLAUSES; ++i) {
-        for (size_t j = i + 1; j < N_CLAUSES; ++j) {
-            size_t max_left = 0;
-            for (size_t k = 0; k < CLAUSES[j - 1].size; ++k) {
-                if (CLAUSES[j - 1].lits[k] > 0) {
-                    max_left = max_left > CLAUSES[j - 1].lits[k] ? max_left : CLAUSES[j - 1].lits[k];
-                } else {
-                    max_left = max_left > -CLAUSES[j - 1].lits[k] ? max_left : -CLAUSES[j - 1].lits[k];
-                }
-            }
-            size_t max_right = 0;
-            for (size_t k = 0; k < CLAUSES[j].size; ++k) {
-                if (CLAUSES[j].lits[k] > 0) {
-                    max_right = max_right > CLAUSES[j].lits[k] ? max_right : CLAUSES[j].lits[k];
-                } else {
-                    max_right = max_right > -CLAUSES[j].lits[k] ? max_right : -CLAUSES[j].lits[k];
-                }
-            }
-            if (max_right < max_left || (max_right == max_left && CLAUSES[j - 1].size > CLAUSES[j].size)) {
-                Clause tmp = CLAUSES[j - 1];
-                CLAUSES[j - 1] = CLAUSES[j];
-                CLAUSES[j] = tmp;
-            }
+// Desc: look-ahead decision: probe both polarities of preselected candidates,
+// commit failed literals and necessary assignments into frame
+// Returns literal to branch on first, or 0 if frame was changed
+int32_t
+calc_param_lookahead(Solver *s, Frame fr);
+
+static uint64_t
+solver_rand(Solver *s) {
+    // xorshift64*
+    s->seed ^= s->seed >> 12;
+    s->seed ^= s->seed << 25;
+    s->seed ^= s->seed >> 27;
+    return s->seed * 2685821657736338717ull;
+}
+
+static void
+solver_shuffle(Solver *s) {
+    for (size_t i = s->n_vars; i > 1; --i) {
+        size_t j = solver_rand(s) % i;
+        int32_t tmp = s->order[i - 1];
+        s->order[i - 1] = s->order[j];
+        s->order[j] = tmp;
+    }
+}
+
+// Desc: i-th element of Luby sequence 1 1 2 1 1 2 4 1 1 2 ..., i starts from 1
+static uint64_t
+luby(uint64_t i) {
+    uint64_t k = 1;
+    while ((1ull << k) - 1 < i) {
+        k++;
+    }
+    while ((1ull << k) - 1 != i) {
+        i -= (1ull << (k - 1)) - 1;
+        k = 1;
+        while ((1ull << k) - 1 < i) {
+            k++;
         }
     }
-    int16_t *clause_arr = calloc(clauses_size, sizeof(*clause_arr));
-    size_t cnt = 0;
-    for (size_t i = 0; i < N_CLAUSES; ++i) {
-        size_t start = cnt;
-        for (size_t j = 0; j < CLAUSES[i].size; ++j, ++cnt) {
-            clause_arr[cnt] = CLAUSES[i].lits[j];
+    return 1ull << (k - 1);
+}
+
+void
+solver_init(Solver *s, const Formula *f, int id, Tetrits root) {
+    memset(s, 0, sizeof(*s));
+    s->f = f;
+    s->n_vars = f->n_vars;
+    s->id = id;
+    s->heuristic = H_FIRST;
+    s->polarity = POL_POSITIVE;
+    s->seed = 0x9e3779b97f4a7c15ull * (id + 1);
+#ifdef __x86_64__
+    s->simd = __builtin_cpu_supports("avx2") != 0;
+#endif
+    s->root = root;
+    // Frames are allocated on first use, search rarely goes deep
+    s->stack = calloc(s->n_vars + 1, sizeof(*s->stack));
+    s->order = malloc((s->n_vars ? s->n_vars : 1) * sizeof(*s->order));
+    s->imp_queue = malloc((s->n_vars + 1) * sizeof(*s->imp_queue));
+    for (size_t i = 0; i < s->n_vars; ++i) {
+        s->order[i] = i + 1;
+    }
+}
+
+void
+solver_free(Solver *s) {
+    for (size_t i = 0; i <= s->n_vars && s->stack[i].inter; ++i) {
+        tetrits_free(s->stack[i].inter, s->n_vars);
+    }
+    for (size_t i = 0; i < s->extra_size; ++i) {
+        free(s->extra[i].lits);
+    }
+    tetrits_free(s->la_pos, s->n_vars);
+    tetrits_free(s->la_neg, s->n_vars);
+    tetrits_free(s->la_dbl, s->n_vars);
+    free(s->la_score);
+    free(s->extra);
+    free(s->stack);
+    free(s->path);
+    free(s->lemma);
+    free(s->order);
+    free(s->imp_queue);
+    free(s->xor_rows);
+    free(s->xor_rhs);
+    free(s->xor_pivot);
+}
+
+void
+solver_add_extra(Solver *s, const int32_t *lits, size_t size) {
+    if (s->extra_size == s->extra_cap) {
+        s->extra_cap = s->extra_cap ? 2 * s->extra_cap : 64;
+        s->extra = realloc(s->extra, s->extra_cap * sizeof(*s->extra));
+    }
+    Clause c = {size, malloc((size ? size : 1) * sizeof(*c.lits))};
+    memcpy(c.lits, lits, size * sizeof(*lits));
+    s->extra[s->extra_size++] = c;
+}
+
+// Desc: log lemma: negation of path prefix of given length, negation of probe if it is not 0, and lit
+// if it is not 0. It is RUP when probe and lit are derived by look-ahead below the prefix
+static void
+solver_lemma(Solver *s, size_t length, int32_t probe, int32_t lit) {
+    if (!s->proof) {
+        return;
+    }
+    size_t size = 0;
+    for (size_t i = 0; i < length; ++i) {
+        s->lemma[size++] = -s->path[i];
+    }
+    if (probe) {
+        s->lemma[size++] = -probe;
+    }
+    if (lit) {
+        s->lemma[size++] = lit;
+    }
+    proof_add(s->proof, s->lemma, size);
+}
+
+// Desc: subtree of path prefix of given length is refuted, negation of prefix is implied by formula
+static void
+solver_learn(Solver *s, size_t length) {
+    // Every refuted node is logged: its lemma is RUP given the lemmas of both children
+    solver_lemma(s, length, 0, 0);
+    if (length == 0 || length > EXCHANGE_MAX_LITS) {
+        return;
+    }
+    int32_t lits[EXCHANGE_MAX_LITS];
+    for (size_t i = 0; i < length; ++i) {
+        lits[i] = -s->path[i];
+    }
+    if (s->exchange) {
+        exchange_export(s->exchange, s->id, lits, length);
+    }
+    // Only restarts and further runs revisit refuted subtrees
+    if (s->restarts || s->keep_learned) {
+        solver_add_extra(s, lits, length);
+        s->learned++;
+    }
+}
+
+static void
+solver_restart(Solver *s) {
+    if (s->random_order) {
+        solver_shuffle(s);
+    }
+    tetrits_copy(s->root, s->stack[0].inter, s->n_vars);
+    s->stack[0].depth = 0;
+    s->stack[0].dec = 0;
+    s->stack_size = 1;
+}
+
+// Desc: pop refuted top frame of given depth and learn from it
+static void
+solver_conflict(Solver *s, size_t depth) {
+    s->conflicts++;
+    s->stack_size--;
+    // Next frame is sibling of the path node of its depth, so all path nodes below are refuted.
+    // Assumption nodes have no siblings, only the refuted prefix of them is learned
+    size_t floor = depth < s->n_assumptions ? depth : s->n_assumptions;
+    size_t next_depth = floor;
+    if (s->stack_size > 0) {
+        next_depth = s->stack[s->stack_size - 1].depth;
+    } else {
+        s->failed_size = floor;
+    }
+    for (size_t length = depth; length + 1 > next_depth; --length) {
+        solver_learn(s, length);
+        if (length == 0) {
+            break;
         }
-        free(CLAUSES[i].lits);
-        CLAUSES[i].lits = clause_arr + start;
     }
-    // Main loop
-    while (stack_size > 0) {
-        SolverRes solver_result = solve(stack, &stack_size);
-        if (solver_result == SAT) {
-            printf("SAT\n");
-            free(stack[0].inter - N_VARS);
-            free(stack);
-            free(CLAUSES[0].lits);
-            free(CLAUSES);
-            return 0;
-        } else if (solver_result == UNSAT) {
-            fprintf(stderr, "Unexpected UNSAT in main loop");
-            abort();
+    if (s->exchange) {
+        exchange_import(s->exchange, s);
+    }
+    if (s->restarts && s->stack_size > 0 && s->conflicts >= s->restart_limit) {
+        s->restarts_done++;
+        s->restart_limit = s->conflicts + RESTART_UNIT * luby(s->restarts_done + 1);
+        solver_restart(s);
+    }
+    if (s->on_conflict) {
+        s->on_conflict(s);
+    }
+}
+
+static void
+solver_publish(Solver *s) {
+    Stats *st = s->stats;
+    atomic_store_explicit(&st->decisions, s->decisions, memory_order_relaxed);
+    atomic_store_explicit(&st->propagations, s->propagations, memory_order_relaxed);
+    atomic_store_explicit(&st->conflicts, s->conflicts, memory_order_relaxed);
+    atomic_store_explicit(&st->restarts, s->restarts_done, memory_order_relaxed);
+    atomic_store_explicit(&st->learned, s->learned, memory_order_relaxed);
+    size_t depth = s->stack_size ? s->stack[s->stack_size - 1].depth : 0;
+    atomic_store_explicit(&st->depth, depth, memory_order_relaxed);
+    atomic_store_explicit(&st->stack, s->stack_size, memory_order_relaxed);
+}
+
+SolverRes
+solver_run(Solver *s) {
+    if (!s->stack[0].inter) {
+        s->stack[0].inter = tetrits_alloc(s->n_vars);
+    }
+    // Assumption levels do not branch, but may repeat assigned literals
+    free(s->lemma);
+    s->lemma = malloc((s->n_vars + s->n_assumptions + 3) * sizeof(*s->lemma));
+    s->failed_size = 0;
+    if (s->resumed) {
+        // Stack, path and restart schedule come from the checkpoint
+        s->resumed = 0;
+    } else {
+        free(s->path);
+        s->path = calloc(s->n_vars + s->n_assumptions + 1, sizeof(*s->path));
+        s->restart_limit = s->conflicts + RESTART_UNIT;
+        solver_restart(s);
+    }
+    SolverRes res = UNSAT;
+    while (s->stack_size > 0) {
+        if ((s->stop && atomic_load_explicit(s->stop, memory_order_relaxed))
+                || (s->terminate && s->terminate(s->terminate_data))) {
+            res = UNKNOWN;
+            break;
+        }
+        if (solve(s) == SAT) {
+            res = SAT;
+            break;
+        }
+        // Every step scans the whole formula, publishing is cheap next to it
+        if (s->stats) {
+            solver_publish(s);
         }
     }
-    // Truly UNSAT
-    printf("UNSAT\n");
-    free(stack[0].inter - N_VARS);
-    free(stack);
-    free(CLAUSES[0].lits);
-    free(CLAUSES);
-    return 0;
-} 
+    if (s->stats) {
+        solver_publish(s);
+    }
+    return res;
+}
+
+Tetrits
+solver_model(Solver *s) {
+    return s->stack[s->stack_size - 1].inter;
+}
 
 SolverRes
-solve(Frame *stack, size_t *stack_size) {
-    size_t cf = *stack_size - 1;
-    SolverRes res = prop_one(stack + cf);
-    if (res == SAT) {
-        for (size_t i = 1; i <= N_VARS; ++i) {
-            State s = get(stack[cf].inter, i); 
-            printf("%lu: %s\n", i, s == TRUE ? "True" : (s == FALSE ? "False" : "Unset"));
+solve(Solver *s) {
+    size_t cf = s->stack_size - 1;
+    Frame *stack = s->stack;
+    size_t depth = stack[cf].depth;
+    if (depth > 0) {
+        s->path[depth - 1] = stack[cf].dec;
+    }
+    SolverRes res = prop_one(s, stack + cf);
+    if (res == UNSAT) {
+        solver_conflict(s, depth);
+        return UNKNOWN;
+    }
+    if (depth < s->n_assumptions) {
+        // Next assumption replaces the frame, there is no sibling to return to
+        int32_t a = s->assumptions[depth];
+        if (get(stack[cf].inter, a) == FALSE) {
+            s->path[depth] = a;
+            solver_conflict(s, depth + 1);
+            return UNKNOWN;
         }
+        set(stack[cf].inter, a);
+        stack[cf].depth = depth + 1;
+        stack[cf].dec = a;
+        return UNKNOWN;
+    }
+    if (res == SAT) {
         return SAT;
-    } else if (res == UNSAT) {
-        *stack_size = cf;
+    }
+    int32_t new_param = calc_param(s, stack[cf]);
+    if (new_param == 0) {
+        // Frame was strengthened by heuristic, propagate it once more
         return UNKNOWN;
     }
-    int16_t new_param = calc_param(stack[cf]);
-    *stack_size = cf + 2;
-    tetrits_copy(stack[cf].inter, stack[cf + 1].inter);
+    s->decisions++;
+    s->stack_size = cf + 2;
+    if (!stack[cf + 1].inter) {
+        stack[cf + 1].inter = tetrits_alloc(s->n_vars);
+    }
+    tetrits_copy(stack[cf].inter, stack[cf + 1].inter, s->n_vars);
     set(stack[cf].inter, -new_param);
     set(stack[cf + 1].inter, new_param);
+    stack[cf].depth = stack[cf + 1].depth = depth + 1;
+    stack[cf].dec = -new_param;
+    stack[cf + 1].dec = new_param;
     return UNKNOWN;
 }
 
-SolverRes
-prop_one(Frame *fr) {
+// Desc: evaluate clause under interpretation
+// Returns TRUE if satisfied, else number of unset literals in unk_cnt and the last of them in unk
+static inline State
+clause_eval(Tetrits t, const Clause *c, size_t *unk_cnt, int32_t *unk) {
+    *unk_cnt = 0;
+    for (size_t j = 0; j < c->size; ++j) {
+        switch (get(t, c->lits[j])) {
+            case TRUE:
+                return TRUE;
+            case UNSET:
+                (*unk_cnt)++;
+                *unk = c->lits[j];
+            case FALSE:
+                ;
+        }
+    }
+    return UNSET;
+}
+
+#ifdef __x86_64__
+// Desc: clause_eval which tests 8 literals at once: their values are gathered as 32-bit words at
+// byte offsets, so interpretation is padded; TRUE and UNSET are found by vector compares
+__attribute__((target("avx2")))
+static inline State
+clause_eval_avx2(Tetrits t, const Clause *c, size_t *unk_cnt, int32_t *unk) {
+    if (c->size < SIMD_MIN_CLAUSE) {
+        return clause_eval(t, c, unk_cnt, unk);
+    }
+    const int32_t *lits = c->lits;
+    const __m256i low = _mm256_set1_epi32(0xff);
+    const __m256i true_v = _mm256_set1_epi32(TRUE);
+    const __m256i unset_v = _mm256_set1_epi32(UNSET);
+    size_t cnt = 0, j = 0;
+    for (; j + 8 <= c->size; j += 8) {
+        __m256i idx = _mm256_loadu_si256((const __m256i *)(lits + j));
+        __m256i vals = _mm256_and_si256(_mm256_i32gather_epi32((const int *)t, idx, 1), low);
+        if (_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(vals, true_v)))) {
+            return TRUE;
+        }
+        unsigned unset = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(vals, unset_v)));
+        if (unset) {
+            cnt += __builtin_popcount(unset);
+            *unk = lits[j + 31 - __builtin_clz(unset)];
+        }
+    }
+    for (; j < c->size; ++j) {
+        State v = get(t, lits[j]);
+        if (v == TRUE) {
+            return TRUE;
+        } else if (v == UNSET) {
+            cnt++;
+            *unk = lits[j];
+        }
+    }
+    *unk_cnt = cnt;
+    return UNSET;
+}
+#endif
+
+// Desc: assign literals implied through binary clauses by first tail literals of imp_queue
+// Returns UNSAT on conflict
+static inline SolverRes
+prop_implied(Solver *s, Tetrits t, size_t tail) {
+    const size_t *start = s->f->imp_start;
+    const int32_t *imp = s->f->imp;
+    int32_t *queue = s->imp_queue;
+    for (size_t head = 0; head < tail; ++head) {
+        int32_t lit = queue[head];
+        for (size_t k = start[lit]; k < start[lit + 1]; ++k) {
+            int32_t q = imp[k];
+            State v = get(t, q);
+            if (v == FALSE) {
+                return UNSAT;
+            } else if (v == UNSET) {
+                set(t, q);
+                s->propagations++;
+                queue[tail++] = q;
+            }
+        }
+    }
+    return UNKNOWN;
+}
+
+// Desc: binary clauses are satisfied, if no implication is between unset literals
+static int
+prop_implied_sat(Solver *s, Tetrits t) {
+    const size_t *start = s->f->imp_start;
+    for (int32_t lit = -(int32_t)s->f->n_vars; lit <= (int32_t)s->f->n_vars; ++lit) {
+        if (get(t, lit) != UNSET) {
+            continue;
+        }
+        for (size_t k = start[lit]; k < start[lit + 1]; ++k) {
+            if (get(t, s->f->imp[k]) == UNSET) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+// Desc: body of prop_one, instantiated for each clause evaluation kernel.
+// Binary implications of all TRUE literals go first, then every unit found by the scan,
+// XOR matrix is eliminated and cardinality constraints are counted after each pass over clauses
+static inline __attribute__((always_inline)) SolverRes
+prop_scan(Solver *s, Frame *fr, State (*eval)(Tetrits, const Clause *, size_t *, int32_t *)) {
+    const int binary = s->f->imp != NULL;
+    if (binary) {
+        size_t tail = 0;
+        for (int32_t v = 1; v <= (int32_t)s->f->n_vars; ++v) {
+            State val = get(fr->inter, v);
+            if (val != UNSET) {
+                s->imp_queue[tail++] = val == TRUE ? v : -v;
+            }
+        }
+        if (prop_implied(s, fr->inter, tail) == UNSAT) {
+            return UNSAT;
+        }
+    }
     char not_done = 1;
     while (not_done) {
         char sat = 1;
         not_done = 0;
-        for (size_t i = 0; i < N_CLAUSES; ++i) {
-            size_t unk_cnt = 0;
-            int16_t unk = 0;
-            for (size_t j = 0; j < CLAUSES[i].size; ++j) {
-                switch (get(fr->inter, CLAUSES[i].lits[j])) {
-                    case TRUE:
-                        goto NEXT_CLAUSE;
-                    case UNSET:
-                        unk_cnt++;
-                        unk = CLAUSES[i].lits[j];
-                    case FALSE:
-                        ;
+        for (int set_i = 0; set_i < 2; ++set_i) {
+            const Clause *clauses = set_i ? s->extra : s->f->clauses;
+            size_t n_clauses = set_i ? s->extra_size : s->f->n_clauses;
+            for (size_t i = 0; i < n_clauses; ++i) {
+                size_t unk_cnt;
+                int32_t unk = 0;
+                if (eval(fr->inter, clauses + i, &unk_cnt, &unk) == TRUE) {
+                    continue;
+                }
+                if (unk_cnt == 0) {
+                    return UNSAT;
+                } else if (unk_cnt == 1) {
+                    set(fr->inter, unk);
+                    s->propagations++;
+                    not_done = 1;
+                    if (binary) {
+                        s->imp_queue[0] = unk;
+                        if (prop_implied(s, fr->inter, 1) == UNSAT) {
+                            return UNSAT;
+                        }
+                    }
+                } else {
+                    sat = 0;
                 }
             }
-            if (unk_cnt == 0) {
+        }
+        if (s->f->gauss) {
+            size_t n_units;
+            SolverRes xor_res = xor_propagate(s, fr->inter, s->imp_queue, &n_units);
+            if (xor_res == UNSAT) {
                 return UNSAT;
-            } else if (unk_cnt == 1) {
-                set(fr->inter, unk);
+            }
+            for (size_t k = 0; k < n_units; ++k) {
+                set(fr->inter, s->imp_queue[k]);
+                s->propagations++;
+            }
+            if (n_units) {
                 not_done = 1;
-            } else {
-                sat = 0;
+                if (binary && prop_implied(s, fr->inter, n_units) == UNSAT) {
+                    return UNSAT;
+                }
             }
-NEXT_CLAUSE:;
+            sat &= xor_res == SAT;
         }
-        if (sat) {
+        if (s->f->n_cards) {
+            size_t n_units;
+            SolverRes card_res = card_propagate(s, fr->inter, s->imp_queue, &n_units);
+            if (card_res == UNSAT) {
+                return UNSAT;
+            }
+            s->propagations += n_units;
+            if (n_units) {
+                not_done = 1;
+                if (binary && prop_implied(s, fr->inter, n_units) == UNSAT) {
+                    return UNSAT;
+                }
+            }
+            sat &= card_res == SAT;
+        }
+        if (sat && (!binary || prop_implied_sat(s, fr->inter))) {
             return SAT;
         }
+        if (sat) {
+            // Only binary clauses are left, they need a decision
+            return UNKNOWN;
+        }
     }
     return UNKNOWN;
 }
 
-int16_t
-calc_param(Frame fr) {
-    // Dummy
-    for (size_t i = 1; i <= N_VARS; ++i) {
-        if (get(fr.inter, i) == UNSET) {
-            return i;
+#ifdef __x86_64__
+__attribute__((target("avx2")))
+static SolverRes
+prop_one_avx2(Solver *s, Frame *fr) {
+    return prop_scan(s, fr, clause_eval_avx2);
+}
+#endif
+
+SolverRes
+prop_one(Solver *s, Frame *fr) {
+#ifdef __x86_64__
+    if (s->simd) {
+        return prop_one_avx2(s, fr);
+    }
+#endif
+    return prop_scan(s, fr, clause_eval);
+}
+
+int32_t
+calc_param(Solver *s, Frame fr) {
+    if (s->heuristic == H_LOOKAHEAD) {
+        return calc_param_lookahead(s, fr);
+    }
+    // First unset variable in solver order
+    for (size_t i = 0; i < s->n_vars; ++i) {
+        int32_t v = s->order[i];
+        if (get(fr.inter, v) == UNSET) {
+            if (s->polarity == POL_PHASE) {
+                return get(s->phase, v) == FALSE ? -v : v;
+            }
+            if (s->polarity == POL_NEGATIVE || (s->polarity == POL_RANDOM && (solver_rand(s) & 1))) {
+                return -v;
+            }
+            return v;
         }
     }
     assert(0);
 }
+
+// Desc: weighted number of clauses shrunk (but not satisfied) by going from before to after.
+// New binary clauses weight 1, every extra literal divides weight by 5 as in march
+static double
+la_reduction(Solver *s, Tetrits before, Tetrits after) {
+    static const double weight[] = {0, 0, 1.0, 0.2, 0.04, 0.008, 0.0016};
+    const Clause *clauses = s->f->clauses;
+    double res = 0;
+    for (size_t i = 0; i < s->f->n_clauses; ++i) {
+        size_t unk_before = 0, unk_after = 0;
+        for (size_t j = 0; j < clauses[i].size; ++j) {
+            int32_t lit = clauses[i].lits[j];
+            if (get(after, lit) == TRUE) {
+                goto NEXT_CLAUSE;
+            }
+            unk_before += get(before, lit) == UNSET;
+            unk_after += get(after, lit) == UNSET;
+        }
+        if (unk_after < unk_before) {
+            res += unk_after < sizeof(weight) / sizeof(*weight) ? weight[unk_after] : 0.0003;
+        }
+NEXT_CLAUSE:;
+    }
+    return res;
+}
+
+// Desc: assign lit in copy of src and propagate into dst
+static SolverRes
+la_probe(Solver *s, Tetrits src, Tetrits dst, int32_t lit) {
+    tetrits_copy(src, dst, s->n_vars);
+    set(dst, lit);
+    Frame probe = {dst, 0, 0};
+    return prop_one(s, &probe);
+}
+
+// Desc: commit lit into frame and propagate it
+// Returns 0 if frame is not refuted yet
+static int
+la_commit(Solver *s, Frame fr, int32_t lit) {
+    solver_lemma(s, fr.depth, 0, lit);
+    set(fr.inter, lit);
+    return prop_one(s, &fr) == UNSAT;
+}
+
+// Desc: double look-ahead below probe whose result is in t, frame of probe has given depth
+// Returns 1 if probe is failed on second level; necessary units are fixed in t
+static int
+la_double(Solver *s, size_t depth, int32_t probe, Tetrits t, const int32_t *cand, size_t cand_size) {
+    size_t tries = 0;
+    for (size_t i = 0; i < cand_size && tries < LA_DOUBLE_CANDIDATES; ++i) {
+        int32_t v = cand[i];
+        if (get(t, v) != UNSET) {
+            continue;
+        }
+        tries++;
+        SolverRes pos = la_probe(s, t, s->la_dbl, v);
+        if (pos == SAT) {
+            return 0;
+        }
+        SolverRes neg = la_probe(s, t, s->la_dbl, -v);
+        if (neg == SAT) {
+            return 0;
+        }
+        if (pos == UNSAT && neg == UNSAT) {
+            solver_lemma(s, depth, probe, -v);
+            return 1;
+        }
+        if (pos == UNSAT || neg == UNSAT) {
+            Frame fr = {t, 0, 0};
+            solver_lemma(s, depth, probe, pos == UNSAT ? -v : v);
+            set(t, pos == UNSAT ? -v : v);
+            if (prop_one(s, &fr) == UNSAT) {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+int32_t
+calc_param_lookahead(Solver *s, Frame fr) {
+    if (!s->la_pos) {
+        s->la_pos = tetrits_alloc(s->n_vars);
+        s->la_neg = tetrits_alloc(s->n_vars);
+        s->la_dbl = tetrits_alloc(s->n_vars);
+        s->la_score = calloc(s->n_vars + 1, sizeof(*s->la_score));
+    }
+    double *LA_SCORE = s->la_score;
+    const Clause *clauses = s->f->clauses;
+    size_t n_vars = s->n_vars;
+
+    // Preselection: occurrences in unsatisfied clauses, short clauses count more
+    memset(LA_SCORE, 0, (n_vars + 1) * sizeof(*LA_SCORE));
+    for (size_t i = 0; i < s->f->n_clauses; ++i) {
+        size_t unk_cnt = 0;
+        for (size_t j = 0; j < clauses[i].size; ++j) {
+            State st = get(fr.inter, clauses[i].lits[j]);
+            if (st == TRUE) {
+                goto NEXT_CLAUSE;
+            }
+            unk_cnt += st == UNSET;
+        }
+        for (size_t j = 0; j < clauses[i].size; ++j) {
+            int32_t lit = clauses[i].lits[j];
+            if (get(fr.inter, lit) == UNSET) {
+                LA_SCORE[lit > 0 ? lit : -lit] += 1.0 / (1 << (unk_cnt < 16 ? unk_cnt : 16));
+            }
+        }
+NEXT_CLAUSE:;
+    }
+    // Implications between unset literals are binary clauses
+    if (s->f->imp) {
+        for (int32_t lit = -(int32_t)n_vars; lit <= (int32_t)n_vars; ++lit) {
+            if (get(fr.inter, lit) != UNSET) {
+                continue;
+            }
+            for (size_t k = s->f->imp_start[lit]; k < s->f->imp_start[lit + 1]; ++k) {
+                int32_t q = s->f->imp[k];
+                if (get(fr.inter, q) == UNSET) {
+                    LA_SCORE[lit > 0 ? lit : -lit] += 0.25;
+                    LA_SCORE[q > 0 ? q : -q] += 0.25;
+                }
+            }
+        }
+    }
+    if (s->f->n_xors) {
+        xor_score(s->f, fr.inter, LA_SCORE);
+    }
+    if (s->f->n_cards) {
+        card_score(s->f, fr.inter, LA_SCORE);
+    }
+    int32_t cand[LA_CANDIDATES];
+    size_t cand_size = 0;
+    for (size_t v = 1; v <= n_vars; ++v) {
+        if (LA_SCORE[v] == 0) {
+            continue;
+        }
+        // Insertion into descending top list
+        size_t pos = cand_size < LA_CANDIDATES ? cand_size++ : LA_CANDIDATES;
+        while (pos > 0 && LA_SCORE[cand[pos - 1]] < LA_SCORE[v]) {
+            if (pos < LA_CANDIDATES) {
+                cand[pos] = cand[pos - 1];
+            }
+            pos--;
+        }
+        if (pos < LA_CANDIDATES) {
+            cand[pos] = v;
+        }
+    }
+    assert(cand_size > 0);
+
+    int committed = 0;
+    int32_t best = 0;
+    double best_score = -1;
+    for (size_t i = 0; i < cand_size; ++i) {
+        int32_t v = cand[i];
+        if (get(fr.inter, v) != UNSET) {
+            continue;
+        }
+        SolverRes pos = la_probe(s, fr.inter, s->la_pos, v);
+        if (pos == SAT) {
+            tetrits_copy(s->la_pos, fr.inter, n_vars);
+            return 0;
+        }
+        SolverRes neg = la_probe(s, fr.inter, s->la_neg, -v);
+        if (neg == SAT) {
+            tetrits_copy(s->la_neg, fr.inter, n_vars);
+            return 0;
+        }
+        // Failed literals
+        if (pos == UNSAT || neg == UNSAT) {
+            if (la_commit(s, fr, pos == UNSAT ? -v : v)) {
+                return 0;
+            }
+            committed = 1;
+            continue;
+        }
+        double pos_score = la_reduction(s, fr.inter, s->la_pos);
+        double neg_score = la_reduction(s, fr.inter, s->la_neg);
+        // Failed literals on the second level
+        if (pos_score >= LA_DOUBLE_TRIGGER && la_double(s, fr.depth, v, s->la_pos, cand, cand_size)) {
+            if (la_commit(s, fr, -v)) {
+                return 0;
+            }
+            committed = 1;
+            continue;
+        }
+        if (neg_score >= LA_DOUBLE_TRIGGER && la_double(s, fr.depth, -v, s->la_neg, cand, cand_size)) {
+            if (la_commit(s, fr, v)) {
+                return 0;
+            }
+            committed = 1;
+            continue;
+        }
+        // Necessary assignments: implied by both polarities
+        for (size_t u = 1; u <= n_vars; ++u) {
+            State st = get(s->la_pos, u);
+            int32_t lit = u;
+            if (st != UNSET && st == get(s->la_neg, lit) && get(fr.inter, lit) == UNSET) {
+                lit = st == TRUE ? lit : -lit;
+                solver_lemma(s, fr.depth, v, lit);
+                solver_lemma(s, fr.depth, -v, lit);
+                solver_lemma(s, fr.depth, 0, lit);
+                set(fr.inter, lit);
+                committed = 1;
+            }
+        }
+        if (committed) {
+            continue;
+        }
+        double score = 1024 * pos_score * neg_score + pos_score + neg_score;
+        if (score > best_score) {
+            best_score = score;
+            // Explore the less constrained branch first, it is more likely satisfiable
+            best = pos_score <= neg_score ? v : -v;
+            if (s->polarity == POL_PHASE) {
+                best = get(s->phase, v) == FALSE ? -v : v;
+            }
+        }
+    }
+    if (committed) {
+        return 0;
+    }
+    assert(best);
+    return best;
+}
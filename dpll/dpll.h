@@ -0,0 +1,412 @@
+#pragma once
+
+#include <stddef.h>
+#include <inttypes.h>
+#include <stdatomic.h>
+
+typedef struct Clause {
+    size_t size;
+    int32_t *lits;
+} Clause;
+
+// Interpretation indexed by literal: t[lit] is value of lit, t[-lit] of its negation
+typedef char *Tetrits;
+
+typedef enum State {
+    TRUE = 1,
+    FALSE = 2,
+    UNSET = 0
+} State;
+
+typedef enum SolverRes {
+    SAT,
+    UNSAT,
+    UNKNOWN
+} SolverRes;
+
+// XOR constraint: vars[0] ^ ... ^ vars[size - 1] == rhs, variables are distinct
+typedef struct Xor {
+    size_t size;
+    int32_t *vars;
+    char rhs;
+} Xor;
+
+// XOR constraints in reduced row echelon form, built by xor_build
+typedef struct Gauss Gauss;
+
+// Cardinality constraint: at most bound of lits are TRUE, bound < size.
+// Repeated literal counts every time it occurs
+typedef struct Card {
+    size_t size;
+    int32_t *lits;
+    size_t bound;
+} Card;
+
+// Clauses with literals in one arena
+typedef struct Formula {
+    size_t n_vars;
+    size_t n_clauses;
+    size_t clauses_cap;
+    Clause *clauses;
+    int32_t *arena;
+    size_t arena_size;
+    size_t arena_cap;
+    // Binary clauses moved out of clauses by binary_build, as implication graph:
+    // literals implied by lit are imp[imp_start[lit]] .. imp[imp_start[lit + 1] - 1]; NULL if none
+    size_t *imp_start;
+    int32_t *imp;
+    Xor *xors;
+    size_t n_xors;
+    size_t xors_cap;
+    Gauss *gauss;            // matrix of xors, NULL if none
+    Card *cards;
+    size_t n_cards;
+    size_t cards_cap;
+    // Projection variables of "c ind" lines, models are counted over them
+    int32_t *proj;
+    size_t n_proj;
+} Formula;
+
+typedef enum Heuristic {
+    H_FIRST,     // First unset variable
+    H_LOOKAHEAD  // march/kcnfs-style look-ahead with failed literal probing
+} Heuristic;
+
+typedef enum Polarity {
+    POL_POSITIVE,
+    POL_NEGATIVE,
+    POL_RANDOM,
+    POL_PHASE    // value in phase, e.g. best assignment of local search
+} Polarity;
+
+typedef struct Frame {
+    Tetrits inter;
+    size_t depth;  // number of decisions on the path to the frame
+    int32_t dec;   // decision literal of the frame, 0 for root
+} Frame;
+
+typedef struct Exchange Exchange;
+typedef struct Proof Proof;
+
+// Search counters published by a solver, read by progress reports of other threads
+typedef struct Stats {
+    atomic_uint_least64_t decisions;
+    atomic_uint_least64_t propagations;
+    atomic_uint_least64_t conflicts;
+    atomic_uint_least64_t restarts;
+    atomic_uint_least64_t learned;
+    atomic_uint_least64_t depth;     // decisions on the path to the top frame
+    atomic_uint_least64_t stack;     // frames on the stack
+    struct Stats *next;              // list of all published stats
+} Stats;
+
+// Search state of one solver; portfolio runs several of them on shared formula
+typedef struct Solver Solver;
+
+struct Solver {
+    const Formula *f;
+    size_t n_vars;           // number of variables at init, size of interpretations
+    int id;
+    Heuristic heuristic;
+    Polarity polarity;
+    Tetrits phase;           // preferred values of POL_PHASE
+    char random_order;       // order is reshuffled on every restart
+    char restarts;           // Luby restarts, requires keeping own learned clauses
+    char simd;               // clauses are evaluated with AVX2, set by CPU detection
+    uint64_t seed;
+    Tetrits root;            // root interpretation, search is (re)started from it
+    int32_t *imp_queue;      // TRUE literals whose implications are not propagated yet
+    Frame *stack;
+    size_t stack_size;
+    int32_t *path;           // decisions leading to the current frame
+    int32_t *order;          // variable order of H_FIRST
+    uint64_t decisions;
+    uint64_t propagations;
+    uint64_t conflicts;
+    uint64_t learned;        // clauses added to own learned clauses
+    uint64_t restarts_done;
+    uint64_t restart_limit;
+    Stats *stats;            // counters are published here during search, may be NULL
+    Clause *extra;           // learned and imported clauses
+    size_t extra_size;
+    size_t extra_cap;
+    Exchange *exchange;      // clauses shared with other solvers, may be NULL
+    uint64_t import_pos;     // next exchange slot to read
+    char keep_learned;       // keep short learned clauses between runs
+    char resumed;            // next solver_run continues current state, e.g. loaded from checkpoint
+    // Assumptions are the first decisions of the search, without siblings
+    const int32_t *assumptions;
+    size_t n_assumptions;
+    size_t failed_size;      // after UNSAT: prefix of assumptions which is refuted
+    Proof *proof;            // DRAT lemmas of the search, may be NULL
+    int32_t *lemma;          // scratch for lemmas, sized as path plus two literals
+    // Search is stopped when *stop is set or terminate returns nonzero
+    atomic_int *stop;
+    int (*terminate)(void *data);
+    void *terminate_data;
+    // Look-ahead scratch interpretations: positive probe, negative probe, double look-ahead probe
+    Tetrits la_pos, la_neg, la_dbl;
+    double *la_score;
+    // Gauss-Jordan scratch: matrix rows followed by assigned and TRUE column masks, rhs, pivots
+    uint64_t *xor_rows;
+    char *xor_rhs;
+    size_t *xor_pivot;
+    // Called after every conflict, e.g. to give part of the search away
+    void (*on_conflict)(Solver *s);
+    void *ctx;
+};
+
+// Learned clauses up to this size are kept and shared between portfolio solvers
+#define EXCHANGE_MAX_LITS 8
+
+// Command line options, defined in main.c
+extern Heuristic HEURISTIC;
+extern size_t THREADS;
+// Number of decision variables fixed in cubes, 0 for portfolio mode
+extern size_t CUBE_DEPTH;
+// Share short learned clauses between portfolio solvers
+extern char SHARE;
+// Set to stop search of all solvers: answer is found or run is interrupted
+extern atomic_int STOP;
+// Local search picks variables by WalkSAT rule instead of ProbSAT
+extern char WALKSAT;
+// Best assignment of local search, initial polarity of solvers; NULL if there was no local search
+extern Tetrits PHASE;
+// Search state is saved to CHECKPOINT every CHECKPOINT_INTERVAL seconds and when run stops; may be NULL
+extern const char *CHECKPOINT;
+extern double CHECKPOINT_INTERVAL;
+// Budget of one run in wall clock seconds and conflicts, 0 is no limit
+extern double TIME_LIMIT;
+extern uint64_t CONFLICT_LIMIT;
+
+// Desc: allocate interpretation with all variables unset
+Tetrits
+tetrits_alloc(size_t n_vars);
+
+void
+tetrits_copy(Tetrits src, Tetrits dst, size_t n_vars);
+
+void
+tetrits_free(Tetrits t, size_t n_vars);
+
+void
+set(Tetrits t, int32_t ind);
+
+State
+get(Tetrits t, int32_t ind);
+
+// Desc: append clause, variables above n_vars extend the formula
+void
+formula_add(Formula *f, const int32_t *lits, size_t size);
+
+void
+formula_free(Formula *f);
+
+// Desc: move binary clauses of f into its implication graph; equivalent literals (strongly connected
+// components) share their edges and transitive edges are removed
+void
+binary_build(Formula *f);
+
+// Desc: append XOR of literals, negated literal flips rhs and repeated variables cancel out.
+// Variables above n_vars extend the formula
+void
+formula_add_xor(Formula *f, const int32_t *lits, size_t size);
+
+// Desc: move clauses which together encode an XOR into f->xors
+// Returns number of XORs found
+size_t
+xor_detect(Formula *f);
+
+// Desc: eliminate f->xors into f->gauss, dependent XORs are dropped
+// Returns UNSAT if XORs contradict each other, else UNKNOWN
+SolverRes
+xor_build(Formula *f);
+
+void
+xor_free(Gauss *g);
+
+// Desc: eliminate variables assigned in t from XOR matrix; literals implied by it are stored into units
+// Returns UNSAT on conflict, SAT if all XORs hold, else UNKNOWN
+SolverRes
+xor_propagate(Solver *s, Tetrits t, int32_t *units, size_t *n_units);
+
+// Desc: add look-ahead preselection score of unset variables in XORs
+void
+xor_score(const Formula *f, Tetrits t, double *score);
+
+// Desc: append constraint "at most bound of lits are TRUE", it is dropped if bound is not below size.
+// Variables above n_vars extend the formula
+void
+formula_add_card(Formula *f, const int32_t *lits, size_t size, size_t bound);
+
+// Desc: replace cliques of binary clauses (pairwise at-most-one encodings) with f->cards
+// Returns number of constraints found
+size_t
+card_detect(Formula *f);
+
+// Desc: count TRUE literals of every cardinality constraint; at the bound the unset ones are set
+// FALSE in t and stored into units
+// Returns UNSAT on conflict, SAT if all constraints hold whatever unset variables are, else UNKNOWN
+SolverRes
+card_propagate(Solver *s, Tetrits t, int32_t *units, size_t *n_units);
+
+// Desc: add look-ahead preselection score of unset variables in cardinality constraints
+void
+card_score(const Formula *f, Tetrits t, double *score);
+
+// Desc: load DIMACS CNF from file, or stdin if path is NULL, into f.
+// Plain, gzip and xz input is accepted, "x" lines are XOR constraints, lines ending with "<= k" or
+// ">= k" instead of 0 are cardinality constraints, "c ind" lines are projection variables.
+// Exits on malformed input
+void
+dimacs_load(Formula *f, const char *path);
+
+// Desc: print model as a single DIMACS "v" line, unset variables as FALSE
+void
+dimacs_print_model(Tetrits t, size_t n_vars);
+
+// Desc: open DRAT proof file, binary or text
+Proof *
+proof_open(const char *path, int binary);
+
+// Desc: flush and close proof
+void
+proof_close(Proof *p);
+
+// Desc: log lemma, p may be NULL
+void
+proof_add(Proof *p, const int32_t *lits, size_t size);
+
+// Desc: log deletion of clause, p may be NULL
+void
+proof_delete(Proof *p, const int32_t *lits, size_t size);
+
+// Desc: simplify f in place: tautologies, duplicates and subsumed clauses removal,
+// self-subsuming strengthening, equivalent literal substitution, bounded variable elimination.
+// Resulting clauses are placed into new arena. Added and deleted clauses are logged into proof
+// Returns UNSAT if formula is refuted, else UNKNOWN
+SolverRes
+preprocess(Formula *f, Proof *proof);
+
+// Desc: assign variables which are not in preprocessed formula anymore, so search does not branch on them
+void
+preprocess_assign(Tetrits t);
+
+// Desc: extend model of preprocessed formula to the model of original one.
+// Unset variables are fixed to FALSE
+void
+preprocess_extend(Tetrits t);
+
+// Desc: init solver on f with default configuration, search starts from root
+void
+solver_init(Solver *s, const Formula *f, int id, Tetrits root);
+
+void
+solver_free(Solver *s);
+
+// Desc: add clause implied by the formula to the solver
+void
+solver_add_extra(Solver *s, const int32_t *lits, size_t size);
+
+// Desc: run search under assumptions until answer or stop
+// Returns SAT, UNSAT, or UNKNOWN if stopped
+SolverRes
+solver_run(Solver *s);
+
+// Desc: model found by solver_run
+Tetrits
+solver_model(Solver *s);
+
+// Desc: propagate units in frame
+// Returns SAT if all clauses are satisfied, UNSAT on conflict, else UNKNOWN
+SolverRes
+prop_one(Solver *s, Frame *fr);
+
+// Desc: choose param for split using solver heuristic
+// Returns new param, or 0 if heuristic assigned variables in frame and it must be propagated again
+int32_t
+calc_param(Solver *s, Frame fr);
+
+// Desc: allocate empty exchange buffer, freed by free()
+Exchange *
+exchange_alloc(void);
+
+// Desc: publish clause to other solvers, lock-free
+void
+exchange_export(Exchange *ex, int producer, const int32_t *lits, size_t size);
+
+// Desc: add clauses published by other solvers since last import to s
+void
+exchange_import(Exchange *ex, Solver *s);
+
+// Desc: allocate stats, they are summed up by reports until stats_finish
+Stats *
+stats_alloc(void);
+
+// Desc: start reporting thread: progress line every interval seconds (0 is never),
+// SIGUSR1 prints current stats, SIGINT sets STOP. Must be called before other threads start
+void
+stats_start(double interval);
+
+// Desc: stop reporting and print final stats as JSON
+void
+stats_finish(SolverRes res);
+
+// Desc: ProbSAT or WalkSAT local search on clauses of f from random assignment, variables assigned
+// in root are kept. Runs until all clauses are satisfied, seconds pass (0 is no limit) or STOP.
+// The assignment with fewest unsatisfied clauses is stored into best
+// Returns SAT if best satisfies all clauses, else UNKNOWN
+SolverRes
+sls_solve(const Formula *f, Tetrits root, Tetrits best, double seconds, uint64_t seed);
+
+// Desc: exact model count of f by DPLL with component decomposition and component cache,
+// projected on f->proj if there are projection variables. Search counters go to stats
+// Returns count in decimal, freed by free(), or NULL if STOP was set
+char *
+count_solve(const Formula *f, Stats *stats);
+
+// Desc: enumerate models of f from root, projected on f->proj if there are projection variables.
+// Each is printed as soon as it is found, as a "v" line of a cube: missing variables are don't
+// cares, cubes are disjoint. Search counters go to stats
+// Returns SAT after all models, UNSAT if there is none, UNKNOWN if STOP was set
+SolverRes
+allsat_solve(const Formula *f, Tetrits root, Stats *stats);
+
+// Desc: find backbone of f from root, literals TRUE in every model, of projected variables if f has
+// projection. Each is printed as a "b" line as soon as it is proven, "b 0" ends complete backbone
+// Returns SAT, UNSAT if there is no model, UNKNOWN if STOP was set
+SolverRes
+backbone_solve(const Formula *f, Tetrits root, Stats *stats);
+
+// Desc: find symmetries of clauses of f as automorphisms of its literal-clause graph and add
+// lex-leader clauses for each generator. Satisfiability is kept, models are not, and new
+// auxiliary variables extend f
+void
+symmetry_break(Formula *f);
+
+// Desc: save search state of s to path: stack of frames, decisions, learned clauses, counters and
+// variable order. File is replaced atomically
+// Returns 1 on success, 0 if file could not be written
+int
+checkpoint_save(const Solver *s, const char *path);
+
+// Desc: load search state of initialized solver s from path, next solver_run continues it. Exits if
+// the file is not a checkpoint of the same formula
+void
+checkpoint_load(Solver *s, const char *path);
+
+// Desc: terminate callback, data is the solver: saves CHECKPOINT periodically
+// Returns nonzero when TIME_LIMIT or CONFLICT_LIMIT of this run is used up
+int
+checkpoint_terminate(void *data);
+
+// Desc: run THREADS diversified solvers from root, first answer stops all
+// Returns SAT with model copied into model, or UNSAT
+SolverRes
+portfolio_solve(const Formula *f, Tetrits root, Tetrits model);
+
+// Desc: cube-and-conquer: split search on first CUBE_DEPTH decisions, THREADS workers
+// solve cubes under assumptions, stealing cubes of each other and splitting long ones
+// Returns SAT with model copied into model, or UNSAT
+SolverRes
+cube_solve(const Formula *f, Tetrits root, Tetrits model);
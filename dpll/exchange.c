@@ -0,0 +1,76 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <assert.h>
+#include "dpll.h"
+
+// Exchange tuning
+#define EXCHANGE_SLOTS 4096     // ring buffer size, power of 2; slow readers lose oldest clauses
+
+// Slot is guarded by sequence number: 2 * pos + 1 while written, 2 * pos + 2 when done
+typedef struct Slot {
+    atomic_uint_fast64_t seq;
+    atomic_int producer;
+    atomic_int size;
+    atomic_int lits[EXCHANGE_MAX_LITS];
+} Slot;
+
+struct Exchange {
+    atomic_uint_fast64_t head;
+    Slot slots[EXCHANGE_SLOTS];
+};
+
+Exchange *
+exchange_alloc(void) {
+    Exchange *ex = calloc(1, sizeof(*ex));
+    assert(ex);
+    return ex;
+}
+
+void
+exchange_export(Exchange *ex, int producer, const int32_t *lits, size_t size) {
+    assert(size <= EXCHANGE_MAX_LITS);
+    uint64_t pos = atomic_fetch_add_explicit(&ex->head, 1, memory_order_relaxed);
+    Slot *slot = ex->slots + (pos & (EXCHANGE_SLOTS - 1));
+    atomic_store_explicit(&slot->seq, 2 * pos + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&slot->producer, producer, memory_order_relaxed);
+    atomic_store_explicit(&slot->size, size, memory_order_relaxed);
+    for (size_t i = 0; i < size; ++i) {
+        atomic_store_explicit(slot->lits + i, lits[i], memory_order_relaxed);
+    }
+    atomic_store_explicit(&slot->seq, 2 * pos + 2, memory_order_release);
+}
+
+void
+exchange_import(Exchange *ex, Solver *s) {
+    uint64_t head = atomic_load_explicit(&ex->head, memory_order_acquire);
+    if (head - s->import_pos > EXCHANGE_SLOTS) {
+        s->import_pos = head - EXCHANGE_SLOTS;
+    }
+    for (; s->import_pos < head; ++s->import_pos) {
+        uint64_t pos = s->import_pos;
+        Slot *slot = ex->slots + (pos & (EXCHANGE_SLOTS - 1));
+        uint64_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        if (seq < 2 * pos + 2) {
+            // Writer is not done yet, retry on next import
+            break;
+        }
+        if (seq > 2 * pos + 2) {
+            // Overwritten by newer clause
+            continue;
+        }
+        int producer = atomic_load_explicit(&slot->producer, memory_order_relaxed);
+        int size = atomic_load_explicit(&slot->size, memory_order_relaxed);
+        int32_t lits[EXCHANGE_MAX_LITS];
+        for (int i = 0; i < size && i < EXCHANGE_MAX_LITS; ++i) {
+            lits[i] = atomic_load_explicit(slot->lits + i, memory_order_relaxed);
+        }
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&slot->seq, memory_order_relaxed) != seq || producer == s->id) {
+            continue;
+        }
+        solver_add_extra(s, lits, size);
+    }
+}
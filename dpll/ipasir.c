@@ -0,0 +1,209 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <assert.h>
+#include "dpll.h"
+#include "ipasir.h"
+
+typedef enum IpasirState {
+    I_INPUT,  // clauses or assumptions were added since last answer
+    I_SAT,
+    I_UNSAT
+} IpasirState;
+
+typedef struct Ipasir {
+    Formula f;
+    Solver s;
+    char has_solver;
+    Tetrits root;          // all variables unset, sized by solver
+    int32_t *clause;       // clause being added
+    size_t clause_size, clause_cap;
+    int32_t *assumptions;
+    size_t assumptions_size, assumptions_cap;
+    int32_t *failed;       // failed assumptions core of the last UNSAT answer
+    size_t failed_size;
+    Tetrits model;         // model of the last SAT answer
+    size_t model_vars;
+    IpasirState state;
+    int (*terminate)(void *data);
+    void *terminate_data;
+    void (*learn)(void *data, int32_t *clause);
+    void *learn_data;
+    int learn_max;
+} Ipasir;
+
+static void
+ipasir_push(int32_t **arr, size_t *size, size_t *cap, int32_t lit) {
+    if (*size == *cap) {
+        *cap = *cap ? 2 * *cap : 16;
+        *arr = realloc(*arr, *cap * sizeof(**arr));
+        assert(*arr);
+    }
+    (*arr)[(*size)++] = lit;
+}
+
+// Desc: make solver match formula size, learned clauses survive re-creation
+static void
+ipasir_prepare(Ipasir *I) {
+    if (I->has_solver && I->s.n_vars == I->f.n_vars) {
+        return;
+    }
+    Clause *extra = NULL;
+    size_t extra_size = 0, extra_cap = 0;
+    if (I->has_solver) {
+        extra = I->s.extra;
+        extra_size = I->s.extra_size;
+        extra_cap = I->s.extra_cap;
+        I->s.extra = NULL;
+        I->s.extra_size = 0;
+        tetrits_free(I->root, I->s.n_vars);
+        solver_free(&I->s);
+    }
+    I->root = tetrits_alloc(I->f.n_vars);
+    solver_init(&I->s, &I->f, 0, I->root);
+    I->s.keep_learned = 1;
+    I->s.extra = extra;
+    I->s.extra_size = extra_size;
+    I->s.extra_cap = extra_cap;
+    I->has_solver = 1;
+}
+
+const char *
+ipasir_signature(void) {
+    return "dpll-ipasir-1.0";
+}
+
+void *
+ipasir_init(void) {
+    Ipasir *I = calloc(1, sizeof(*I));
+    assert(I);
+    return I;
+}
+
+void
+ipasir_release(void *solver) {
+    Ipasir *I = solver;
+    if (I->has_solver) {
+        tetrits_free(I->root, I->s.n_vars);
+        solver_free(&I->s);
+    }
+    tetrits_free(I->model, I->model_vars);
+    formula_free(&I->f);
+    free(I->clause);
+    free(I->assumptions);
+    free(I->failed);
+    free(I);
+}
+
+void
+ipasir_add(void *solver, int32_t lit_or_zero) {
+    Ipasir *I = solver;
+    I->state = I_INPUT;
+    if (lit_or_zero) {
+        ipasir_push(&I->clause, &I->clause_size, &I->clause_cap, lit_or_zero);
+        return;
+    }
+    formula_add(&I->f, I->clause, I->clause_size);
+    I->clause_size = 0;
+}
+
+void
+ipasir_assume(void *solver, int32_t lit) {
+    Ipasir *I = solver;
+    I->state = I_INPUT;
+    size_t var = lit > 0 ? lit : -lit;
+    I->f.n_vars = var > I->f.n_vars ? var : I->f.n_vars;
+    ipasir_push(&I->assumptions, &I->assumptions_size, &I->assumptions_cap, lit);
+}
+
+int
+ipasir_solve(void *solver) {
+    Ipasir *I = solver;
+    ipasir_prepare(I);
+    Solver *s = &I->s;
+    s->assumptions = I->assumptions;
+    s->n_assumptions = I->assumptions_size;
+    s->terminate = I->terminate;
+    s->terminate_data = I->terminate_data;
+    size_t learned_before = s->extra_size;
+    SolverRes res = solver_run(s);
+    int ret = 0;
+    if (res == SAT) {
+        tetrits_free(I->model, I->model_vars);
+        I->model_vars = s->n_vars;
+        I->model = tetrits_alloc(s->n_vars);
+        tetrits_copy(solver_model(s), I->model, s->n_vars);
+        I->state = I_SAT;
+        ret = 10;
+    } else if (res == UNSAT) {
+        I->failed = realloc(I->failed, (s->failed_size + 1) * sizeof(*I->failed));
+        if (s->failed_size) {
+            memcpy(I->failed, I->assumptions, s->failed_size * sizeof(*I->failed));
+        }
+        I->failed_size = s->failed_size;
+        I->state = I_UNSAT;
+        ret = 20;
+    } else {
+        I->state = I_INPUT;
+    }
+    if (I->learn) {
+        int32_t clause[EXCHANGE_MAX_LITS + 1];
+        for (size_t i = learned_before; i < s->extra_size; ++i) {
+            if ((int)s->extra[i].size > I->learn_max) {
+                continue;
+            }
+            memcpy(clause, s->extra[i].lits, s->extra[i].size * sizeof(*clause));
+            clause[s->extra[i].size] = 0;
+            I->learn(I->learn_data, clause);
+        }
+    }
+    s->assumptions = NULL;
+    s->n_assumptions = 0;
+    I->assumptions_size = 0;
+    return ret;
+}
+
+int32_t
+ipasir_val(void *solver, int32_t lit) {
+    Ipasir *I = solver;
+    assert(I->state == I_SAT);
+    size_t var = lit > 0 ? lit : -lit;
+    if (var <= I->model_vars) {
+        State v = get(I->model, lit);
+        if (v == TRUE) {
+            return lit;
+        } else if (v == FALSE) {
+            return -lit;
+        }
+    }
+    // Don't care variables are FALSE, as in printed models
+    return lit > 0 ? -lit : lit;
+}
+
+int
+ipasir_failed(void *solver, int32_t lit) {
+    Ipasir *I = solver;
+    assert(I->state == I_UNSAT);
+    for (size_t i = 0; i < I->failed_size; ++i) {
+        if (I->failed[i] == lit) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void
+ipasir_set_terminate(void *solver, void *data, int (*terminate)(void *data)) {
+    Ipasir *I = solver;
+    I->terminate = terminate;
+    I->terminate_data = data;
+}
+
+void
+ipasir_set_learn(void *solver, void *data, int max_length, void (*learn)(void *data, int32_t *clause)) {
+    Ipasir *I = solver;
+    I->learn = learn;
+    I->learn_data = data;
+    I->learn_max = max_length;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <inttypes.h>
+
+// IPASIR: reentrant incremental SAT solver API.
+// Solver state (clauses, learned clauses) persists between ipasir_solve calls
+
+// Desc: name and version of the solver
+const char *
+ipasir_signature(void);
+
+// Desc: create new solver instance
+void *
+ipasir_init(void);
+
+// Desc: destroy solver instance and free its memory
+void
+ipasir_release(void *solver);
+
+// Desc: add literal to the clause being built, 0 finishes it
+void
+ipasir_add(void *solver, int32_t lit_or_zero);
+
+// Desc: assume literal for the next ipasir_solve call only
+void
+ipasir_assume(void *solver, int32_t lit);
+
+// Desc: solve formula under current assumptions, assumptions are cleared after the call
+// Returns 10 if SAT, 20 if UNSAT, 0 if interrupted by terminate callback
+int
+ipasir_solve(void *solver);
+
+// Desc: value of literal in the model, valid after SAT answer
+// Returns lit if it is TRUE, -lit if FALSE (variables absent from model are FALSE)
+int32_t
+ipasir_val(void *solver, int32_t lit);
+
+// Desc: check if assumption lit is in the failed assumptions core, valid after UNSAT answer
+// Returns 1 if it is, else 0
+int
+ipasir_failed(void *solver, int32_t lit);
+
+// Desc: set callback which is checked during search, nonzero result interrupts it
+void
+ipasir_set_terminate(void *solver, void *data, int (*terminate)(void *data));
+
+// Desc: set callback receiving learned clauses of up to max_length literals, zero terminated.
+// Clauses are reported at the end of ipasir_solve
+void
+ipasir_set_learn(void *solver, void *data, int max_length, void (*learn)(void *data, int32_t *clause));
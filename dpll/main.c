@@ -0,0 +1,301 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "dpll.h"
+
+Heuristic HEURISTIC = H_FIRST;
+char PREPROCESS = 1;
+char SYMMETRY = 1;
+size_t THREADS = 1;
+size_t CUBE_DEPTH = 0;
+char SHARE = 1;
+atomic_int STOP;
+char WALKSAT = 0;
+Tetrits PHASE;
+const char *CHECKPOINT;
+double CHECKPOINT_INTERVAL = 300;
+double TIME_LIMIT = 0;
+uint64_t CONFLICT_LIMIT = 0;
+
+// Desc: order clauses by maximal variable, then by size
+static int
+clause_cmp(const void *l, const void *r) {
+    const Clause *left = l, *right = r;
+    size_t max_left = 0, max_right = 0;
+    for (size_t k = 0; k < left->size; ++k) {
+        size_t var = left->lits[k] > 0 ? left->lits[k] : -left->lits[k];
+        max_left = max_left > var ? max_left : var;
+    }
+    for (size_t k = 0; k < right->size; ++k) {
+        size_t var = right->lits[k] > 0 ? right->lits[k] : -right->lits[k];
+        max_right = max_right > var ? max_right : var;
+    }
+    if (max_left != max_right) {
+        return max_left < max_right ? -1 : 1;
+    }
+    return (left->size > right->size) - (left->size < right->size);
+}
+
+// Desc: copy clauses into new arena in their order, for locality of propagation scan
+static void
+clauses_flatten(Formula *f) {
+    size_t clauses_size = 0;
+    for (size_t i = 0; i < f->n_clauses; ++i) {
+        clauses_size += f->clauses[i].size;
+    }
+    int32_t *clause_arr = malloc((clauses_size ? clauses_size : 1) * sizeof(*clause_arr));
+    size_t cnt = 0;
+    for (size_t i = 0; i < f->n_clauses; ++i) {
+        memcpy(clause_arr + cnt, f->clauses[i].lits, f->clauses[i].size * sizeof(*clause_arr));
+        f->clauses[i].lits = clause_arr + cnt;
+        cnt += f->clauses[i].size;
+    }
+    free(f->arena);
+    f->arena = clause_arr;
+    f->arena_size = f->arena_cap = clauses_size;
+}
+
+int
+main(int argc, char **argv) {
+    const char *path = NULL;
+    const char *proof_path = NULL;
+    int proof_binary = 1;
+    double progress = 10;
+    int sls_only = 0;
+    int count = 0;
+    int all = 0;
+    int backbone = 0;
+    double sls_time = 0;
+    const char *resume = NULL;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--lookahead")) {
+            HEURISTIC = H_LOOKAHEAD;
+        } else if (!strcmp(argv[i], "--no-preprocess")) {
+            PREPROCESS = 0;
+        } else if (!strcmp(argv[i], "--no-symmetry")) {
+            SYMMETRY = 0;
+        } else if (!strcmp(argv[i], "--threads") && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            THREADS = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--cubes") && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            CUBE_DEPTH = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--proof") && i + 1 < argc) {
+            proof_path = argv[++i];
+        } else if (!strcmp(argv[i], "--proof-text")) {
+            proof_binary = 0;
+        } else if (!strcmp(argv[i], "--no-share")) {
+            SHARE = 0;
+        } else if (!strcmp(argv[i], "--sls")) {
+            sls_only = 1;
+        } else if (!strcmp(argv[i], "--sls-time") && i + 1 < argc && atof(argv[i + 1]) > 0) {
+            sls_time = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--walksat")) {
+            WALKSAT = 1;
+        } else if (!strcmp(argv[i], "--count")) {
+            count = 1;
+        } else if (!strcmp(argv[i], "--all")) {
+            all = 1;
+        } else if (!strcmp(argv[i], "--backbone")) {
+            backbone = 1;
+        } else if (!strcmp(argv[i], "--checkpoint") && i + 1 < argc) {
+            CHECKPOINT = argv[++i];
+        } else if (!strcmp(argv[i], "--checkpoint-interval") && i + 1 < argc && atof(argv[i + 1]) >= 0) {
+            CHECKPOINT_INTERVAL = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--resume") && i + 1 < argc) {
+            resume = argv[++i];
+        } else if (!strcmp(argv[i], "--time-limit") && i + 1 < argc && atof(argv[i + 1]) > 0) {
+            TIME_LIMIT = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--conflict-limit") && i + 1 < argc && atoll(argv[i + 1]) > 0) {
+            CONFLICT_LIMIT = atoll(argv[++i]);
+        } else if (!strcmp(argv[i], "--progress") && i + 1 < argc && atof(argv[i + 1]) >= 0) {
+            progress = atof(argv[++i]);
+        } else if (argv[i][0] != '-' && !path) {
+            path = argv[i];
+        } else {
+            fprintf(stderr, "Usage: %s [--lookahead] [--no-preprocess] [--no-symmetry] [--threads N] [--no-share] [--cubes K] [--proof FILE [--proof-text]] [--sls | --sls-time SECONDS] [--walksat] [--count | --all | --backbone] [--checkpoint FILE [--checkpoint-interval SECONDS]] [--resume FILE] [--time-limit SECONDS] [--conflict-limit N] [--progress SECONDS] [file.cnf[.gz|.xz]]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (proof_path && (THREADS > 1 || CUBE_DEPTH)) {
+        fprintf(stderr, "Proof output requires single-threaded search\n");
+        return 1;
+    }
+    // Resumed run keeps saving its progress to the same file unless told otherwise
+    if (resume && !CHECKPOINT) {
+        CHECKPOINT = resume;
+    }
+    int budget = CHECKPOINT || TIME_LIMIT > 0 || CONFLICT_LIMIT > 0;
+    if (budget && (THREADS > 1 || CUBE_DEPTH || proof_path || count || all || backbone || sls_only)) {
+        fprintf(stderr, "Checkpoints and run limits require single-threaded search without proof\n");
+        return 1;
+    }
+    if (count && proof_path) {
+        fprintf(stderr, "Proof output is not supported for counting\n");
+        return 1;
+    }
+    if ((all || backbone) && (count || proof_path || THREADS > 1 || CUBE_DEPTH || sls_only)) {
+        fprintf(stderr, "Model enumeration and backbone require single-threaded search without proof\n");
+        return 1;
+    }
+    Proof *proof = proof_path ? proof_open(proof_path, proof_binary) : NULL;
+    stats_start(progress);
+
+    Formula f = {0};
+    dimacs_load(&f, path);
+    // Symmetry breaking adds variables which are not part of the model
+    size_t n_input = f.n_vars;
+    if (count) {
+        // Preprocessing keeps satisfiability, not the number of models, so counting takes input as is
+        if (f.n_xors || f.n_cards) {
+            fprintf(stderr, "Counting does not support XOR and cardinality constraints\n");
+            return 1;
+        }
+        char *models = count_solve(&f, stats_alloc());
+        SolverRes res = !models ? UNKNOWN : strcmp(models, "0") ? SAT : UNSAT;
+        if (models) {
+            printf("s mc %s\n", models);
+        } else {
+            // Interrupted
+            printf("UNKNOWN\n");
+        }
+        free(models);
+        stats_finish(res);
+        formula_free(&f);
+        return 0;
+    }
+    if (all || backbone) {
+        // Preprocessing and symmetry breaking keep satisfiability, not the models, so models are
+        // searched on input as is
+        if (f.n_xors || f.n_cards) {
+            fprintf(stderr, "Model enumeration and backbone do not support XOR and cardinality constraints\n");
+            return 1;
+        }
+        qsort(f.clauses, f.n_clauses, sizeof(*f.clauses), clause_cmp);
+        binary_build(&f);
+        clauses_flatten(&f);
+        Tetrits root = tetrits_alloc(f.n_vars);
+        SolverRes res = all ? allsat_solve(&f, root, stats_alloc()) : backbone_solve(&f, root, stats_alloc());
+        // Models and backbone literals are streamed, the result comes last
+        printf("%s\n", res == SAT ? "SAT" : res == UNSAT ? "UNSAT" : "UNKNOWN");
+        stats_finish(res);
+        tetrits_free(root, f.n_vars);
+        formula_free(&f);
+        return 0;
+    }
+    if (proof && (f.n_xors || f.n_cards)) {
+        fprintf(stderr, "Proof output does not support XOR and cardinality constraints\n");
+        return 1;
+    }
+    // Hidden XORs are found before preprocessing changes clauses; proof checker knows only clauses
+    if (!proof) {
+        xor_detect(&f);
+    }
+    // Breaking clauses are not implied by the formula, so they can not be in a proof.
+    // Clauses alone do not show symmetries of XOR and cardinality constraints. Elimination in
+    // preprocessing treats interchangeable variables differently, so symmetries are found before it
+    if (SYMMETRY && !proof && !f.n_xors && !f.n_cards) {
+        symmetry_break(&f);
+    }
+    if (PREPROCESS && preprocess(&f, proof) == UNSAT) {
+        printf("UNSAT\n");
+        if (proof) {
+            proof_close(proof);
+        }
+        stats_finish(UNSAT);
+        formula_free(&f);
+        return 0;
+    }
+    // At-most-one cliques are compressed once preprocessing has reasoned over their binary clauses
+    if (!proof) {
+        card_detect(&f);
+    }
+    qsort(f.clauses, f.n_clauses, sizeof(*f.clauses), clause_cmp);
+    binary_build(&f);
+    if (xor_build(&f) == UNSAT) {
+        printf("UNSAT\n");
+        stats_finish(UNSAT);
+        formula_free(&f);
+        return 0;
+    }
+    clauses_flatten(&f);
+
+    Tetrits root = tetrits_alloc(f.n_vars);
+    if (PREPROCESS) {
+        preprocess_assign(root);
+    }
+    Tetrits model = tetrits_alloc(f.n_vars);
+    SolverRes solver_result = UNKNOWN;
+    if (sls_only && (f.n_xors || f.n_cards)) {
+        fprintf(stderr, "Local search does not support XOR and cardinality constraints\n");
+        return 1;
+    }
+    // Resumed search has its phase in the checkpoint
+    if (!resume && (sls_only || sls_time > 0)) {
+        PHASE = tetrits_alloc(f.n_vars);
+        solver_result = sls_solve(&f, root, PHASE, sls_time, 1);
+        // Local search sees clauses only
+        if (solver_result == SAT && !f.n_xors && !f.n_cards) {
+            tetrits_copy(PHASE, model, f.n_vars);
+        } else {
+            solver_result = UNKNOWN;
+        }
+    }
+    // Search runs unless local search found a model or is the only engine
+    if (solver_result != SAT && !sls_only) {
+        if (CUBE_DEPTH) {
+            solver_result = cube_solve(&f, root, model);
+        } else if (THREADS > 1) {
+            solver_result = portfolio_solve(&f, root, model);
+        } else {
+            Solver s;
+            solver_init(&s, &f, 0, root);
+            s.heuristic = HEURISTIC;
+            if (PHASE) {
+                s.polarity = POL_PHASE;
+                s.phase = PHASE;
+            }
+            s.proof = proof;
+            s.stop = &STOP;
+            s.stats = stats_alloc();
+            if (resume) {
+                checkpoint_load(&s, resume);
+                PHASE = s.phase;
+            }
+            if (budget) {
+                s.terminate = checkpoint_terminate;
+                s.terminate_data = &s;
+            }
+            solver_result = solver_run(&s);
+            // Stopped by limit or interrupt, the run can be continued from here
+            if (solver_result == UNKNOWN && CHECKPOINT) {
+                checkpoint_save(&s, CHECKPOINT);
+            }
+            if (solver_result == SAT) {
+                tetrits_copy(solver_model(&s), model, f.n_vars);
+            }
+            solver_free(&s);
+        }
+    }
+    if (solver_result == SAT) {
+        if (PREPROCESS) {
+            preprocess_extend(model);
+        }
+        printf("SAT\n");
+        dimacs_print_model(model, n_input);
+    } else if (solver_result == UNSAT) {
+        // Truly UNSAT
+        printf("UNSAT\n");
+    } else {
+        // Interrupted
+        printf("UNKNOWN\n");
+    }
+    if (proof) {
+        proof_close(proof);
+    }
+    stats_finish(solver_result);
+    tetrits_free(root, f.n_vars);
+    tetrits_free(model, f.n_vars);
+    tetrits_free(PHASE, f.n_vars);
+    formula_free(&f);
+    return 0;
+}
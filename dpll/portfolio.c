@@ -0,0 +1,97 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <assert.h>
+#include <pthread.h>
+#include "dpll.h"
+
+static Exchange *EXCHANGE;
+
+typedef struct Worker {
+    pthread_t thread;
+    Solver solver;
+    SolverRes res;
+} Worker;
+
+static pthread_mutex_t WINNER_LOCK = PTHREAD_MUTEX_INITIALIZER;
+static Worker *WINNER;
+
+// Desc: diversify solver configuration by its id
+static void
+portfolio_configure(Solver *s) {
+    switch (s->id) {
+        case 0:
+            // Configuration given by options, starting from local search assignment if there is one
+            if (PHASE) {
+                s->polarity = POL_PHASE;
+                s->phase = PHASE;
+            }
+            break;
+        case 1:
+            s->polarity = POL_NEGATIVE;
+            break;
+        case 2:
+            s->heuristic = s->heuristic == H_LOOKAHEAD ? H_FIRST : H_LOOKAHEAD;
+            break;
+        default:
+            s->heuristic = H_FIRST;
+            s->polarity = POL_RANDOM;
+            s->random_order = 1;
+            s->restarts = 1;
+    }
+}
+
+static void *
+portfolio_worker(void *arg) {
+    Worker *w = arg;
+    w->res = solver_run(&w->solver);
+    if (w->res != UNKNOWN) {
+        pthread_mutex_lock(&WINNER_LOCK);
+        if (!WINNER) {
+            WINNER = w;
+            atomic_store(&STOP, 1);
+        }
+        pthread_mutex_unlock(&WINNER_LOCK);
+    }
+    return NULL;
+}
+
+SolverRes
+portfolio_solve(const Formula *f, Tetrits root, Tetrits model) {
+    if (SHARE) {
+        EXCHANGE = exchange_alloc();
+    }
+    Worker *workers = calloc(THREADS, sizeof(*workers));
+    for (size_t i = 0; i < THREADS; ++i) {
+        Solver *s = &workers[i].solver;
+        solver_init(s, f, i, root);
+        s->heuristic = HEURISTIC;
+        s->exchange = EXCHANGE;
+        s->stop = &STOP;
+        s->stats = stats_alloc();
+        portfolio_configure(s);
+        if (pthread_create(&workers[i].thread, NULL, portfolio_worker, workers + i)) {
+            fprintf(stderr, "Failed to start thread %lu\n", i);
+            exit(1);
+        }
+    }
+    for (size_t i = 0; i < THREADS; ++i) {
+        pthread_join(workers[i].thread, NULL);
+    }
+    // No winner if interrupted
+    SolverRes res = WINNER ? WINNER->res : UNKNOWN;
+    if (res == SAT) {
+        tetrits_copy(solver_model(&WINNER->solver), model, f->n_vars);
+    }
+    if (WINNER) {
+        fprintf(stderr, "c portfolio: solver %d won\n", WINNER->solver.id);
+    }
+    for (size_t i = 0; i < THREADS; ++i) {
+        solver_free(&workers[i].solver);
+    }
+    free(workers);
+    free(EXCHANGE);
+    EXCHANGE = NULL;
+    return res;
+}
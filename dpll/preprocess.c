@@ -0,0 +1,801 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <assert.h>
+#include "dpll.h"
+
+// Preprocessing tuning
+#define PRE_ROUNDS 8              // rounds of substitution, subsumption and elimination
+#define PRE_OCC_LIMIT 32          // max occurrences of both polarities for variable elimination
+#define PRE_RESOLVENT_LIMIT 16    // max resolvent size for variable elimination
+#define PRE_SUBSUME_OCC_LIMIT 512 // longer occurrence lists are not scanned for subsumption
+
+typedef struct PClause {
+    int32_t *lits;
+    size_t size;
+    uint64_t sig;  // bit per variable modulo 64, for fast subset rejection
+    char removed;
+} PClause;
+
+typedef struct Occ {
+    size_t *idx;
+    size_t size;
+    size_t cap;
+} Occ;
+
+static Formula *F;      // formula being preprocessed, kept for model extension
+static Proof *PROOF;
+static char PRE_LOADING; // original clauses are being added, they are already known to proof checker
+static PClause *PC;
+static size_t PC_SIZE, PC_CAP;
+static Occ *OCC;        // clause indexes by literal, removed clauses are skipped lazily
+static Tetrits VAL;     // top level assignment, kept for model extension
+static Tetrits MARK;    // scratch marks by literal
+static char *GONE;      // eliminated or substituted variables
+static char *FROZEN;    // variables of XOR and cardinality constraints, neither eliminated nor substituted
+static int32_t *UNITS;  // assigned literals to be propagated
+static size_t UNITS_HEAD, UNITS_SIZE;
+static size_t *QUEUE;   // clauses to be checked for subsumption
+static size_t QUEUE_SIZE, QUEUE_CAP;
+static char *QUEUED;
+static char PRE_UNSAT;
+
+// Elimination stack for model extension: clause lits with pivot first, followed by clause size
+static int32_t *ELIM;
+static size_t ELIM_SIZE, ELIM_CAP;
+
+static void *
+pre_grow(void *arr, size_t *cap, size_t need, size_t elem) {
+    if (need <= *cap) {
+        return arr;
+    }
+    *cap = *cap * 2 > need ? *cap * 2 : need;
+    arr = realloc(arr, *cap * elem);
+    assert(arr);
+    return arr;
+}
+
+static size_t
+var_of(int32_t lit) {
+    return lit > 0 ? lit : -lit;
+}
+
+static void
+occ_push(int32_t lit, size_t ci) {
+    Occ *o = OCC + lit;
+    o->idx = pre_grow(o->idx, &o->cap, o->size + 1, sizeof(*o->idx));
+    o->idx[o->size++] = ci;
+}
+
+// Desc: remove removed clauses and clauses not containing lit anymore from occurrence list
+static void
+occ_clean(int32_t lit) {
+    Occ *o = OCC + lit;
+    size_t j = 0;
+    for (size_t i = 0; i < o->size; ++i) {
+        if (!PC[o->idx[i]].removed) {
+            o->idx[j++] = o->idx[i];
+        }
+    }
+    o->size = j;
+}
+
+static void
+elim_push(const int32_t *lits, size_t size, int32_t pivot) {
+    ELIM = pre_grow(ELIM, &ELIM_CAP, ELIM_SIZE + size + 1, sizeof(*ELIM));
+    ELIM[ELIM_SIZE++] = pivot;
+    for (size_t i = 0; i < size; ++i) {
+        if (lits[i] != pivot) {
+            ELIM[ELIM_SIZE++] = lits[i];
+        }
+    }
+    ELIM[ELIM_SIZE++] = size;
+}
+
+static void
+queue_push(size_t ci) {
+    if (QUEUED[ci]) {
+        return;
+    }
+    QUEUE = pre_grow(QUEUE, &QUEUE_CAP, QUEUE_SIZE + 1, sizeof(*QUEUE));
+    QUEUE[QUEUE_SIZE++] = ci;
+    QUEUED[ci] = 1;
+}
+
+static void
+pre_assign(int32_t lit) {
+    if (get(VAL, lit) == TRUE) {
+        return;
+    }
+    if (get(VAL, lit) == FALSE) {
+        // Logged while its reason is still there, conflicting units make empty clause RUP
+        proof_add(PROOF, &lit, 1);
+        PRE_UNSAT = 1;
+        return;
+    }
+    set(VAL, lit);
+    UNITS[UNITS_SIZE++] = lit;
+    proof_add(PROOF, &lit, 1);
+}
+
+static int
+lit_cmp(const void *l, const void *r) {
+    int32_t left = *(const int32_t *)l, right = *(const int32_t *)r;
+    return left - right;
+}
+
+static uint64_t
+pre_sig(const int32_t *lits, size_t size) {
+    uint64_t sig = 0;
+    for (size_t i = 0; i < size; ++i) {
+        sig |= 1ull << (var_of(lits[i]) & 63);
+    }
+    return sig;
+}
+
+// Desc: forget clause without logging, it is already replaced in proof
+static void
+pre_free(size_t ci) {
+    PC[ci].removed = 1;
+    free(PC[ci].lits);
+    PC[ci].lits = NULL;
+}
+
+static void
+pre_remove(size_t ci) {
+    proof_delete(PROOF, PC[ci].lits, PC[ci].size);
+    pre_free(ci);
+}
+
+// Desc: log shrinking of clause, which now has size literals, by lit
+static void
+pre_proof_shrink(const int32_t *lits, size_t size, int32_t lit) {
+    if (!PROOF) {
+        return;
+    }
+    // Units are logged on assignment
+    if (size > 1) {
+        proof_add(PROOF, lits, size);
+    }
+    int32_t *old = malloc((size + 1) * sizeof(*old));
+    memcpy(old, lits, size * sizeof(*old));
+    old[size] = lit;
+    proof_delete(PROOF, old, size + 1);
+    free(old);
+}
+
+// Desc: add clause to the formula: drop false and duplicate literals, tautologies and satisfied clauses,
+// assign units. Lits are copied
+static void
+pre_add(const int32_t *lits, size_t size) {
+    int32_t *res = malloc((size ? size : 1) * sizeof(*res));
+    size_t res_size = 0;
+    for (size_t i = 0; i < size; ++i) {
+        State s = get(VAL, lits[i]);
+        if (s == TRUE || get(MARK, -lits[i])) {
+            goto SATISFIED;
+        }
+        if (s == FALSE || get(MARK, lits[i])) {
+            continue;
+        }
+        MARK[lits[i]] = 1;
+        res[res_size++] = lits[i];
+    }
+    for (size_t i = 0; i < res_size; ++i) {
+        MARK[res[i]] = 0;
+    }
+    // Original clause is replaced by the normalized one, other clauses are new lemmas. Derived
+    // clause is logged before its original is deleted, it is RUP only while that is there
+    int changed = res_size != size;
+    if (res_size == 0) {
+        proof_add(PROOF, NULL, 0);
+        PRE_UNSAT = 1;
+    } else if (res_size == 1) {
+        pre_assign(res[0]);
+    } else if (changed || !PRE_LOADING) {
+        proof_add(PROOF, res, res_size);
+    }
+    if (PRE_LOADING && changed) {
+        proof_delete(PROOF, lits, size);
+    }
+    if (res_size <= 1) {
+        free(res);
+        return;
+    }
+    qsort(res, res_size, sizeof(*res), lit_cmp);
+    size_t old_cap = PC_CAP;
+    PC = pre_grow(PC, &PC_CAP, PC_SIZE + 1, sizeof(*PC));
+    if (PC_CAP != old_cap) {
+        QUEUED = realloc(QUEUED, PC_CAP);
+    }
+    PC[PC_SIZE] = (PClause){res, res_size, pre_sig(res, res_size), 0};
+    for (size_t i = 0; i < res_size; ++i) {
+        occ_push(res[i], PC_SIZE);
+    }
+    QUEUED[PC_SIZE] = 0;
+    queue_push(PC_SIZE);
+    PC_SIZE++;
+    return;
+SATISFIED:
+    for (size_t i = 0; i < res_size; ++i) {
+        MARK[res[i]] = 0;
+    }
+    if (PRE_LOADING) {
+        proof_delete(PROOF, lits, size);
+    }
+    free(res);
+}
+
+// Desc: remove literal from clause
+static void
+pre_strengthen(size_t ci, int32_t lit) {
+    PClause *c = PC + ci;
+    size_t j = 0;
+    for (size_t i = 0; i < c->size; ++i) {
+        if (c->lits[i] != lit) {
+            c->lits[j++] = c->lits[i];
+        }
+    }
+    c->size = j;
+    Occ *o = OCC + lit;
+    for (size_t i = 0; i < o->size; ++i) {
+        if (o->idx[i] == ci) {
+            o->idx[i] = o->idx[--o->size];
+            break;
+        }
+    }
+    if (c->size == 1) {
+        pre_assign(c->lits[0]);
+        pre_proof_shrink(c->lits, c->size, lit);
+        pre_free(ci);
+        return;
+    }
+    pre_proof_shrink(c->lits, c->size, lit);
+    c->sig = pre_sig(c->lits, c->size);
+    queue_push(ci);
+}
+
+// Desc: propagate units at top level
+static void
+pre_propagate(void) {
+    while (UNITS_HEAD < UNITS_SIZE && !PRE_UNSAT) {
+        int32_t lit = UNITS[UNITS_HEAD++];
+        Occ *o = OCC + lit;
+        for (size_t i = 0; i < o->size; ++i) {
+            if (!PC[o->idx[i]].removed) {
+                pre_remove(o->idx[i]);
+            }
+        }
+        o->size = 0;
+        // All occurrences of -lit are removed, so the list is taken at once
+        o = OCC - lit;
+        size_t *idx = o->idx;
+        size_t size = o->size;
+        o->idx = NULL;
+        o->size = o->cap = 0;
+        for (size_t i = 0; i < size && !PRE_UNSAT; ++i) {
+            PClause *c = PC + idx[i];
+            if (c->removed) {
+                continue;
+            }
+            size_t k = 0;
+            for (size_t j = 0; j < c->size; ++j) {
+                if (c->lits[j] != -lit) {
+                    c->lits[k++] = c->lits[j];
+                }
+            }
+            c->size = k;
+            if (k == 0) {
+                PRE_UNSAT = 1;
+            } else if (k == 1) {
+                pre_assign(c->lits[0]);
+                pre_proof_shrink(c->lits, k, -lit);
+                pre_free(idx[i]);
+            } else {
+                pre_proof_shrink(c->lits, k, -lit);
+                c->sig = pre_sig(c->lits, k);
+                queue_push(idx[i]);
+            }
+        }
+        free(idx);
+    }
+}
+
+// Desc: check if clause c subsumes clause d or strengthens it by self-subsuming resolution
+// Returns 0 if neither, else 1 with literal to remove from d in strengthen or 0 if d is subsumed
+static int
+pre_subsumes(PClause *c, PClause *d, int32_t *strengthen) {
+    if (c->size > d->size || (c->sig & ~d->sig)) {
+        return 0;
+    }
+    for (size_t i = 0; i < d->size; ++i) {
+        MARK[d->lits[i]] = 1;
+    }
+    int res = 1;
+    *strengthen = 0;
+    for (size_t i = 0; i < c->size; ++i) {
+        int32_t lit = c->lits[i];
+        if (get(MARK, lit)) {
+            continue;
+        }
+        if (*strengthen == 0 && get(MARK, -lit)) {
+            *strengthen = -lit;
+            continue;
+        }
+        res = 0;
+        break;
+    }
+    for (size_t i = 0; i < d->size; ++i) {
+        MARK[d->lits[i]] = 0;
+    }
+    return res;
+}
+
+// Desc: backward subsumption and self-subsuming strengthening for queued clauses
+static void
+pre_subsume(void) {
+    size_t *occ = NULL;
+    size_t occ_cap = 0;
+    for (size_t q = 0; q < QUEUE_SIZE && !PRE_UNSAT; ++q) {
+        size_t ci = QUEUE[q];
+        QUEUED[ci] = 0;
+        if (PC[ci].removed) {
+            continue;
+        }
+        // Variable of clause with the shortest occurrence lists
+        int32_t best = PC[ci].lits[0];
+        for (size_t i = 1; i < PC[ci].size; ++i) {
+            int32_t lit = PC[ci].lits[i];
+            if (OCC[lit].size + OCC[-lit].size < OCC[best].size + OCC[-best].size) {
+                best = lit;
+            }
+        }
+        if (OCC[best].size + OCC[-best].size > PRE_SUBSUME_OCC_LIMIT) {
+            continue;
+        }
+        for (int pol = 0; pol < 2; ++pol) {
+            int32_t lit = pol ? -best : best;
+            // Copy, since strengthening modifies occurrence lists
+            size_t occ_size = OCC[lit].size;
+            if (occ_size == 0) {
+                continue;
+            }
+            occ = pre_grow(occ, &occ_cap, occ_size, sizeof(*occ));
+            memcpy(occ, OCC[lit].idx, occ_size * sizeof(*occ));
+            for (size_t i = 0; i < occ_size && !PC[ci].removed; ++i) {
+                size_t di = occ[i];
+                if (di == ci || PC[di].removed) {
+                    continue;
+                }
+                int32_t lit_out;
+                if (!pre_subsumes(PC + ci, PC + di, &lit_out)) {
+                    continue;
+                }
+                if (lit_out == 0) {
+                    pre_remove(di);
+                } else {
+                    pre_strengthen(di, lit_out);
+                }
+            }
+        }
+        pre_propagate();
+    }
+    QUEUE_SIZE = 0;
+    free(occ);
+}
+
+// Desc: resolve c and d on var
+// Returns size of resolvent in res or -1 if it is tautology
+static long
+pre_resolve(PClause *c, PClause *d, size_t var, int32_t *res) {
+    long size = 0;
+    for (size_t i = 0; i < c->size; ++i) {
+        if (var_of(c->lits[i]) != var) {
+            MARK[c->lits[i]] = 1;
+            res[size++] = c->lits[i];
+        }
+    }
+    for (size_t i = 0; i < d->size; ++i) {
+        int32_t lit = d->lits[i];
+        if (var_of(lit) == var || get(MARK, lit)) {
+            continue;
+        }
+        if (get(MARK, -lit)) {
+            size = -1;
+            break;
+        }
+        res[size++] = lit;
+    }
+    for (size_t i = 0; i < c->size; ++i) {
+        MARK[c->lits[i]] = 0;
+    }
+    return size;
+}
+
+static size_t *ORDER_KEY;
+
+static int
+order_cmp(const void *l, const void *r) {
+    size_t left = ORDER_KEY[*(const size_t *)l], right = ORDER_KEY[*(const size_t *)r];
+    return (left > right) - (left < right);
+}
+
+// Desc: bounded variable elimination: variable is replaced by its non-tautological resolvents
+// if there are no more of them than clauses containing variable
+// Returns number of eliminated variables
+static size_t
+pre_eliminate(void) {
+    size_t *order = malloc(F->n_vars * sizeof(*order));
+    ORDER_KEY = calloc(F->n_vars + 1, sizeof(*ORDER_KEY));
+    size_t order_size = 0;
+    for (size_t v = 1; v <= F->n_vars; ++v) {
+        if (GONE[v] || FROZEN[v] || get(VAL, v) != UNSET) {
+            continue;
+        }
+        occ_clean(v);
+        occ_clean(-(int32_t)v);
+        ORDER_KEY[v] = OCC[v].size * OCC[-(int32_t)v].size;
+        order[order_size++] = v;
+    }
+    qsort(order, order_size, sizeof(*order), order_cmp);
+
+    int32_t *res = malloc(2 * F->n_vars * sizeof(*res));
+    int32_t *resolvents = NULL;
+    size_t resolvents_size = 0, resolvents_cap = 0;
+    size_t eliminated = 0;
+    for (size_t k = 0; k < order_size && !PRE_UNSAT; ++k) {
+        int32_t v = order[k];
+        if (get(VAL, v) != UNSET) {
+            continue;
+        }
+        occ_clean(v);
+        occ_clean(-v);
+        Occ *pos = OCC + v, *neg = OCC - v;
+        if (pos->size + neg->size == 0 || pos->size + neg->size > PRE_OCC_LIMIT) {
+            continue;
+        }
+        // Count resolvents, collecting them as size-prefixed records
+        size_t limit = pos->size + neg->size;
+        size_t count = 0;
+        resolvents_size = 0;
+        for (size_t i = 0; i < pos->size && count <= limit; ++i) {
+            for (size_t j = 0; j < neg->size && count <= limit; ++j) {
+                long size = pre_resolve(PC + pos->idx[i], PC + neg->idx[j], v, res);
+                if (size < 0) {
+                    continue;
+                }
+                if (size > PRE_RESOLVENT_LIMIT) {
+                    count = limit + 1;
+                    break;
+                }
+                count++;
+                resolvents = pre_grow(resolvents, &resolvents_cap, resolvents_size + size + 1, sizeof(*resolvents));
+                resolvents[resolvents_size++] = size;
+                memcpy(resolvents + resolvents_size, res, size * sizeof(*res));
+                resolvents_size += size;
+            }
+        }
+        if (count > limit) {
+            continue;
+        }
+        // Store the smaller side for model extension, the other polarity is default
+        Occ *keep = pos->size <= neg->size ? pos : neg;
+        int32_t pivot = keep == pos ? v : -v;
+        for (size_t i = 0; i < keep->size; ++i) {
+            elim_push(PC[keep->idx[i]].lits, PC[keep->idx[i]].size, pivot);
+        }
+        int32_t unit = -pivot;
+        elim_push(&unit, 1, unit);
+        // Resolvents are added while their antecedents are still there, for proof
+        for (size_t i = 0; i < resolvents_size; i += resolvents[i] + 1) {
+            pre_add(resolvents + i + 1, resolvents[i]);
+        }
+        for (size_t i = 0; i < pos->size; ++i) {
+            pre_remove(pos->idx[i]);
+        }
+        for (size_t i = 0; i < neg->size; ++i) {
+            pre_remove(neg->idx[i]);
+        }
+        pos->size = neg->size = 0;
+        GONE[v] = 1;
+        eliminated++;
+        pre_propagate();
+    }
+    free(resolvents);
+    free(res);
+    free(order);
+    free(ORDER_KEY);
+    return eliminated;
+}
+
+// Desc: equivalent literal substitution: strongly connected components of binary implication graph
+// are replaced by their literal with the smallest variable
+// Returns number of substituted variables
+static size_t
+pre_substitute(void) {
+    size_t n = 2 * F->n_vars + 1;
+    // Implication graph over literals (index lit + F->n_vars) in CSR form
+    size_t *start = calloc(n + 1, sizeof(*start));
+    for (size_t ci = 0; ci < PC_SIZE; ++ci) {
+        if (!PC[ci].removed && PC[ci].size == 2) {
+            start[-PC[ci].lits[0] + F->n_vars + 1]++;
+            start[-PC[ci].lits[1] + F->n_vars + 1]++;
+        }
+    }
+    for (size_t i = 0; i < n; ++i) {
+        start[i + 1] += start[i];
+    }
+    int32_t *edges = malloc((start[n] ? start[n] : 1) * sizeof(*edges));
+    size_t *fill = malloc(n * sizeof(*fill));
+    memcpy(fill, start, n * sizeof(*fill));
+    for (size_t ci = 0; ci < PC_SIZE; ++ci) {
+        if (!PC[ci].removed && PC[ci].size == 2) {
+            int32_t a = PC[ci].lits[0], b = PC[ci].lits[1];
+            edges[fill[-a + F->n_vars]++] = b;
+            edges[fill[-b + F->n_vars]++] = a;
+        }
+    }
+
+    // Iterative Tarjan
+    size_t *index = calloc(n, sizeof(*index));  // 0 is unvisited
+    size_t *low = malloc(n * sizeof(*low));
+    char *on_stack = calloc(n, 1);
+    int32_t *scc_stack = malloc(n * sizeof(*scc_stack));
+    int32_t *call_stack = malloc(n * sizeof(*call_stack));
+    size_t *edge_pos = malloc(n * sizeof(*edge_pos));
+    int32_t *repr = calloc(n, sizeof(*repr));
+    size_t scc_size = 0, counter = 0;
+    for (size_t root = 0; root < n && start[n]; ++root) {
+        if (index[root] || root == F->n_vars || start[root] == start[root + 1]) {
+            continue;
+        }
+        size_t call_size = 0;
+        call_stack[call_size++] = root - F->n_vars;
+        index[root] = low[root] = ++counter;
+        edge_pos[root] = start[root];
+        scc_stack[scc_size++] = root - F->n_vars;
+        on_stack[root] = 1;
+        while (call_size) {
+            size_t u = call_stack[call_size - 1] + F->n_vars;
+            if (edge_pos[u] < start[u + 1]) {
+                size_t w = edges[edge_pos[u]++] + F->n_vars;
+                if (!index[w]) {
+                    index[w] = low[w] = ++counter;
+                    edge_pos[w] = start[w];
+                    scc_stack[scc_size++] = w - F->n_vars;
+                    on_stack[w] = 1;
+                    call_stack[call_size++] = w - F->n_vars;
+                } else if (on_stack[w] && index[w] < low[u]) {
+                    low[u] = index[w];
+                }
+                continue;
+            }
+            call_size--;
+            if (call_size) {
+                size_t parent = call_stack[call_size - 1] + F->n_vars;
+                if (low[u] < low[parent]) {
+                    low[parent] = low[u];
+                }
+            }
+            if (low[u] != index[u]) {
+                continue;
+            }
+            // u is root of component: representative is literal with the smallest variable
+            size_t first = scc_size;
+            int32_t best = u - F->n_vars;
+            do {
+                first--;
+                if (var_of(scc_stack[first]) < var_of(best)) {
+                    best = scc_stack[first];
+                }
+            } while (scc_stack[first] != (int32_t)(u - F->n_vars));
+            for (size_t i = first; i < scc_size; ++i) {
+                on_stack[scc_stack[i] + F->n_vars] = 0;
+                repr[scc_stack[i] + F->n_vars] = best;
+            }
+            for (size_t i = first; i < scc_size; ++i) {
+                if (repr[-scc_stack[i] + F->n_vars] == best && !PRE_UNSAT) {
+                    // Complementary literals in one component, both are implied by implication chains
+                    int32_t lit = scc_stack[i];
+                    proof_add(PROOF, &lit, 1);
+                    lit = -lit;
+                    proof_add(PROOF, &lit, 1);
+                    PRE_UNSAT = 1;
+                }
+            }
+            scc_size = first;
+        }
+    }
+    free(start);
+    free(edges);
+    free(fill);
+    free(index);
+    free(low);
+    free(on_stack);
+    free(scc_stack);
+    free(call_stack);
+    free(edge_pos);
+    if (PRE_UNSAT) {
+        free(repr);
+        return 0;
+    }
+
+    // Equivalences are logged first, while implication chains are complete, substituted clauses are RUP with them
+    for (size_t v = 1; v <= F->n_vars && PROOF; ++v) {
+        int32_t r = repr[v + F->n_vars];
+        if (r == 0 || r == (int32_t)v || GONE[v] || FROZEN[v] || get(VAL, v) != UNSET) {
+            continue;
+        }
+        int32_t eq[2][2] = {{-(int32_t)v, r}, {v, -r}};
+        proof_add(PROOF, eq[0], 2);
+        proof_add(PROOF, eq[1], 2);
+    }
+    size_t substituted = 0;
+    int32_t *lits = malloc(F->n_vars * sizeof(*lits));
+    for (size_t v = 1; v <= F->n_vars; ++v) {
+        int32_t r = repr[v + F->n_vars];
+        if (r == 0 || r == (int32_t)v || GONE[v] || FROZEN[v] || get(VAL, v) != UNSET) {
+            continue;
+        }
+        // v = r: default FALSE, TRUE if r is TRUE
+        int32_t clause[2] = {v, -r};
+        elim_push(clause, 2, v);
+        int32_t unit = -(int32_t)v;
+        elim_push(&unit, 1, unit);
+        GONE[v] = 1;
+        substituted++;
+        for (int pol = 0; pol < 2; ++pol) {
+            int32_t lit = pol ? -(int32_t)v : v;
+            int32_t to = pol ? -r : r;
+            Occ *o = OCC + lit;
+            for (size_t i = 0; i < o->size; ++i) {
+                size_t ci = o->idx[i];
+                if (PC[ci].removed) {
+                    continue;
+                }
+                size_t size = PC[ci].size;
+                for (size_t j = 0; j < size; ++j) {
+                    lits[j] = PC[ci].lits[j] == lit ? to : PC[ci].lits[j];
+                }
+                pre_add(lits, size);
+                pre_remove(ci);
+            }
+            o->size = 0;
+        }
+    }
+    for (size_t v = 1; v <= F->n_vars && PROOF; ++v) {
+        int32_t r = repr[v + F->n_vars];
+        if (r == 0 || r == (int32_t)v || !GONE[v] || get(VAL, v) != UNSET) {
+            continue;
+        }
+        int32_t eq[2][2] = {{-(int32_t)v, r}, {v, -r}};
+        proof_delete(PROOF, eq[0], 2);
+        proof_delete(PROOF, eq[1], 2);
+    }
+    free(lits);
+    free(repr);
+    pre_propagate();
+    return substituted;
+}
+
+SolverRes
+preprocess(Formula *f, Proof *proof) {
+    F = f;
+    PROOF = proof;
+    size_t n = 2 * F->n_vars + 1;
+    VAL = calloc(n, sizeof(*VAL)) + F->n_vars;
+    MARK = calloc(n, sizeof(*MARK)) + F->n_vars;
+    OCC = (Occ *)calloc(n, sizeof(*OCC)) + F->n_vars;
+    GONE = calloc(F->n_vars + 1, sizeof(*GONE));
+    FROZEN = calloc(F->n_vars + 1, sizeof(*FROZEN));
+    for (size_t i = 0; i < F->n_xors; ++i) {
+        for (size_t j = 0; j < F->xors[i].size; ++j) {
+            FROZEN[F->xors[i].vars[j]] = 1;
+        }
+    }
+    for (size_t i = 0; i < F->n_cards; ++i) {
+        for (size_t j = 0; j < F->cards[i].size; ++j) {
+            int32_t lit = F->cards[i].lits[j];
+            FROZEN[lit > 0 ? lit : -lit] = 1;
+        }
+    }
+    UNITS = malloc((F->n_vars + 1) * sizeof(*UNITS));
+
+    size_t old_clauses = F->n_clauses;
+    PRE_LOADING = 1;
+    for (size_t i = 0; i < F->n_clauses && !PRE_UNSAT; ++i) {
+        pre_add(F->clauses[i].lits, F->clauses[i].size);
+        pre_propagate();
+    }
+    PRE_LOADING = 0;
+    pre_subsume();
+    size_t eliminated = 0, substituted = 0;
+    for (size_t round = 0; round < PRE_ROUNDS && !PRE_UNSAT; ++round) {
+        size_t changed = pre_substitute();
+        pre_subsume();
+        if (PRE_UNSAT) {
+            break;
+        }
+        size_t elim = pre_eliminate();
+        pre_subsume();
+        substituted += changed;
+        eliminated += elim;
+        if (changed + elim == 0) {
+            break;
+        }
+    }
+
+    size_t arena_size = 0;
+    F->n_clauses = 0;
+    for (size_t ci = 0; ci < PC_SIZE && !PRE_UNSAT; ++ci) {
+        if (!PC[ci].removed) {
+            arena_size += PC[ci].size;
+            F->n_clauses++;
+        }
+    }
+    free(F->arena);
+    F->arena = malloc((arena_size ? arena_size : 1) * sizeof(*F->arena));
+    F->arena_size = F->arena_cap = arena_size;
+    F->clauses_cap = F->n_clauses ? F->n_clauses : 1;
+    F->clauses = realloc(F->clauses, F->clauses_cap * sizeof(*F->clauses));
+    F->n_clauses = arena_size = 0;
+    for (size_t ci = 0; ci < PC_SIZE; ++ci) {
+        if (!PC[ci].removed && !PRE_UNSAT) {
+            memcpy(F->arena + arena_size, PC[ci].lits, PC[ci].size * sizeof(*F->arena));
+            F->clauses[F->n_clauses++] = (Clause){PC[ci].size, F->arena + arena_size};
+            arena_size += PC[ci].size;
+        }
+        free(PC[ci].lits);
+    }
+    for (size_t i = 0; i < n; ++i) {
+        free(OCC[(long)i - (long)F->n_vars].idx);
+    }
+    free(OCC - F->n_vars);
+    free(MARK - F->n_vars);
+    free(UNITS);
+    free(QUEUE);
+    free(QUEUED);
+    free(PC);
+    free(FROZEN);
+    if (PRE_UNSAT) {
+        proof_add(PROOF, NULL, 0);
+    }
+    fprintf(stderr, "c preprocess: %lu -> %lu clauses, %lu fixed, %lu substituted, %lu eliminated variables\n",
+            old_clauses, F->n_clauses, UNITS_SIZE, substituted, eliminated);
+    return PRE_UNSAT ? UNSAT : UNKNOWN;
+}
+
+void
+preprocess_assign(Tetrits t) {
+    for (size_t v = 1; v <= F->n_vars; ++v) {
+        if (get(VAL, v) != UNSET) {
+            set(t, get(VAL, v) == TRUE ? (int32_t)v : -(int32_t)v);
+        } else if (GONE[v]) {
+            set(t, -(int32_t)v);
+        }
+    }
+}
+
+void
+preprocess_extend(Tetrits t) {
+    for (size_t v = 1; v <= F->n_vars; ++v) {
+        if (get(VAL, v) != UNSET) {
+            set(t, get(VAL, v) == TRUE ? (int32_t)v : -(int32_t)v);
+        } else if (get(t, v) == UNSET) {
+            set(t, -(int32_t)v);
+        }
+    }
+    size_t i = ELIM_SIZE;
+    while (i > 0) {
+        size_t size = ELIM[--i];
+        i -= size;
+        for (size_t j = 1; j < size; ++j) {
+            if (get(t, ELIM[i + j]) == TRUE) {
+                goto NEXT_CLAUSE;
+            }
+        }
+        set(t, ELIM[i]);
+NEXT_CLAUSE:;
+    }
+}
@@ -0,0 +1,121 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "dpll.h"
+
+// Proof tuning
+#define PROOF_BUFFER (4 << 20)   // bytes buffered before write
+
+struct Proof {
+    int fd;
+    char binary;
+    char *buf;
+    size_t size;
+    uint64_t lemmas;
+    uint64_t deletions;
+};
+
+static void
+proof_flush(Proof *p) {
+    size_t done = 0;
+    while (done < p->size) {
+        ssize_t res = write(p->fd, p->buf + done, p->size - done);
+        if (res < 0) {
+            perror("proof");
+            exit(1);
+        }
+        done += res;
+    }
+    p->size = 0;
+}
+
+Proof *
+proof_open(const char *path, int binary) {
+    Proof *p = calloc(1, sizeof(*p));
+    assert(p);
+    p->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (p->fd < 0) {
+        perror(path);
+        exit(1);
+    }
+    p->binary = binary;
+    p->buf = malloc(PROOF_BUFFER);
+    assert(p->buf);
+    return p;
+}
+
+void
+proof_close(Proof *p) {
+    proof_flush(p);
+    close(p->fd);
+    fprintf(stderr, "c proof: %lu lemmas, %lu deletions\n", p->lemmas, p->deletions);
+    free(p->buf);
+    free(p);
+}
+
+static void
+proof_clause(Proof *p, char kind, const int32_t *lits, size_t size) {
+    // Binary: kind byte, 7-bit varints of 2 * var + sign, 0. Text: up to 12 chars per literal
+    if (p->size + 16 + 12 * size > PROOF_BUFFER) {
+        proof_flush(p);
+    }
+    if (p->size + 16 + 12 * size > PROOF_BUFFER) {
+        // Huge clause, writer is not buffered for it
+        p->buf = realloc(p->buf, 16 + 12 * size);
+    }
+    char *out = p->buf + p->size;
+    if (p->binary) {
+        *out++ = kind;
+        for (size_t i = 0; i < size; ++i) {
+            uint32_t u = 2 * (uint32_t)(lits[i] > 0 ? lits[i] : -lits[i]) + (lits[i] < 0);
+            while (u > 127) {
+                *out++ = (char)(u & 127) | 128;
+                u >>= 7;
+            }
+            *out++ = u;
+        }
+        *out++ = 0;
+    } else {
+        if (kind == 'd') {
+            *out++ = 'd';
+            *out++ = ' ';
+        }
+        for (size_t i = 0; i < size; ++i) {
+            char digits[12];
+            size_t n = 0;
+            for (uint32_t x = lits[i] > 0 ? lits[i] : -lits[i]; x; x /= 10) {
+                digits[n++] = '0' + x % 10;
+            }
+            if (lits[i] < 0) {
+                *out++ = '-';
+            }
+            while (n) {
+                *out++ = digits[--n];
+            }
+            *out++ = ' ';
+        }
+        *out++ = '0';
+        *out++ = '\n';
+    }
+    p->size = out - p->buf;
+}
+
+void
+proof_add(Proof *p, const int32_t *lits, size_t size) {
+    if (p) {
+        p->lemmas++;
+        proof_clause(p, 'a', lits, size);
+    }
+}
+
+void
+proof_delete(Proof *p, const int32_t *lits, size_t size) {
+    if (p) {
+        p->deletions++;
+        proof_clause(p, 'd', lits, size);
+    }
+}
@@ -0,0 +1,33 @@
+#!/bin/sh
+# Runs ./dpll on every regress/*.cnf with the options of its "c args:" line, PROOF standing for a
+# temporary file, and checks that each "c expect:" line is a line of the output. Proofs are
+# checked with drat-trim when it is installed
+cd "$(dirname "$0")/.." || exit 1
+proof=$(mktemp)
+failed=0
+for f in regress/*.cnf; do
+    args=$(sed -n 's/^c args: //p' "$f" | sed "s|PROOF|$proof|")
+    out=$(./dpll $args "$f" 2>/dev/null)
+    ok=1
+    sed -n 's/^c expect: //p' "$f" > "$proof.expect"
+    while IFS= read -r line; do
+        printf '%s\n' "$out" | grep -qxF -- "$line" || ok=0
+    done < "$proof.expect"
+    case "$args" in
+        *--proof*)
+            if ! command -v drat-trim >/dev/null; then
+                echo "     $f: drat-trim not installed, proof not checked"
+            elif ! drat-trim "$f" "$proof" | grep -q "s VERIFIED"; then
+                ok=0
+            fi
+            ;;
+    esac
+    if [ $ok = 1 ]; then
+        echo "ok   $f"
+    else
+        echo "FAIL $f"
+        failed=1
+    fi
+done
+rm -f "$proof" "$proof.expect"
+exit $failed
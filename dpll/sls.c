@@ -0,0 +1,336 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <assert.h>
+#include <math.h>
+#include <time.h>
+#include "dpll.h"
+
+// Local search tuning
+#define SLS_CHECK_FLIPS 65536     // flips between looks at the clock and stop flag
+#define SLS_POLY_CB 2.38          // ProbSAT polynomial break base for 3-SAT
+#define SLS_POLY_EPS 1.0
+#define SLS_EXP_CB_5 3.7          // ProbSAT exponential break base up to 5 literals
+#define SLS_EXP_CB_7 5.4          // and for longer clauses
+#define SLS_WALK_NOISE 0.567      // WalkSAT probability of random walk step
+#define SLS_MAX_BREAK 64          // break counts above this have probability of this one
+
+// Clause store of local search: clauses of formula in place, binary clauses of implication graph copied
+static const Clause **CLAUSES;
+static size_t N_CLAUSES;
+static size_t N_VARS;
+static int32_t *BIN_LITS;
+static Clause *BIN;
+// Clauses by literal in CSR form, indexed by lit + N_VARS
+static size_t *OCC_START;
+static size_t *OCC;
+static char *VALUE;          // current value of variable, 1 is TRUE
+static char *FIXED;          // variable is assigned in root, it is never flipped
+static uint32_t *TRUE_COUNT; // TRUE literals of clause
+static int32_t *TRUE_XOR;    // xor of variables of TRUE literals, the only one if TRUE_COUNT is 1
+static uint32_t *BREAK;      // clauses in which variable is the only TRUE literal
+static size_t *FALSE_LIST;   // unsatisfied clauses
+static size_t *FALSE_POS;    // position of clause in FALSE_LIST
+static size_t N_FALSE;
+static double PROB[SLS_MAX_BREAK + 1];
+static uint64_t SEED;
+
+static uint64_t
+sls_rand(void) {
+    // xorshift64*
+    SEED ^= SEED >> 12;
+    SEED ^= SEED << 25;
+    SEED ^= SEED >> 27;
+    return SEED * 2685821657736338717ull;
+}
+
+static double
+sls_rand_unit(void) {
+    return (sls_rand() >> 11) * (1.0 / (1ull << 53));
+}
+
+static double
+sls_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void
+false_add(size_t ci) {
+    FALSE_POS[ci] = N_FALSE;
+    FALSE_LIST[N_FALSE++] = ci;
+}
+
+static void
+false_remove(size_t ci) {
+    size_t last = FALSE_LIST[--N_FALSE];
+    FALSE_LIST[FALSE_POS[ci]] = last;
+    FALSE_POS[last] = FALSE_POS[ci];
+}
+
+// Desc: collect clauses and occurrence lists; binary clauses are read back from implication graph
+static void
+sls_load(const Formula *f) {
+    N_VARS = f->n_vars;
+    size_t n_bin = f->imp ? f->imp_start[(int32_t)N_VARS + 1] - f->imp_start[-(int32_t)N_VARS] : 0;
+    N_CLAUSES = f->n_clauses + n_bin;
+    CLAUSES = malloc((N_CLAUSES ? N_CLAUSES : 1) * sizeof(*CLAUSES));
+    BIN = malloc((n_bin ? n_bin : 1) * sizeof(*BIN));
+    BIN_LITS = malloc((n_bin ? 2 * n_bin : 1) * sizeof(*BIN_LITS));
+    for (size_t i = 0; i < f->n_clauses; ++i) {
+        CLAUSES[i] = f->clauses + i;
+    }
+    // Implication lit -> q is clause (-lit q)
+    size_t k = 0;
+    for (int32_t lit = -(int32_t)N_VARS; lit <= (int32_t)N_VARS && f->imp; ++lit) {
+        for (size_t e = f->imp_start[lit]; e < f->imp_start[lit + 1]; ++e, ++k) {
+            BIN_LITS[2 * k] = -lit;
+            BIN_LITS[2 * k + 1] = f->imp[e];
+            BIN[k] = (Clause){2, BIN_LITS + 2 * k};
+            CLAUSES[f->n_clauses + k] = BIN + k;
+        }
+    }
+    size_t n = 2 * N_VARS + 1;
+    OCC_START = calloc(n + 1, sizeof(*OCC_START));
+    for (size_t ci = 0; ci < N_CLAUSES; ++ci) {
+        for (size_t j = 0; j < CLAUSES[ci]->size; ++j) {
+            OCC_START[CLAUSES[ci]->lits[j] + N_VARS + 1]++;
+        }
+    }
+    for (size_t i = 0; i < n; ++i) {
+        OCC_START[i + 1] += OCC_START[i];
+    }
+    OCC = malloc((OCC_START[n] ? OCC_START[n] : 1) * sizeof(*OCC));
+    size_t *fill = malloc(n * sizeof(*fill));
+    memcpy(fill, OCC_START, n * sizeof(*fill));
+    for (size_t ci = 0; ci < N_CLAUSES; ++ci) {
+        for (size_t j = 0; j < CLAUSES[ci]->size; ++j) {
+            OCC[fill[CLAUSES[ci]->lits[j] + N_VARS]++] = ci;
+        }
+    }
+    free(fill);
+}
+
+static void
+sls_unload(void) {
+    free(CLAUSES);
+    free(BIN);
+    free(BIN_LITS);
+    free(OCC_START);
+    free(OCC);
+    free(VALUE);
+    free(FIXED);
+    free(TRUE_COUNT);
+    free(TRUE_XOR);
+    free(BREAK);
+    free(FALSE_LIST);
+    free(FALSE_POS);
+}
+
+static inline int
+lit_true(int32_t lit) {
+    return VALUE[lit > 0 ? lit : -lit] == (lit > 0);
+}
+
+// Desc: flip variable, keeping true counts, break counts and unsatisfied list up to date
+static inline void
+sls_flip(int32_t v) {
+    VALUE[v] ^= 1;
+    int32_t now_true = VALUE[v] ? v : -v;
+    const size_t *occ = OCC + OCC_START[now_true + N_VARS], *occ_end = OCC + OCC_START[now_true + N_VARS + 1];
+    for (; occ < occ_end; ++occ) {
+        size_t ci = *occ;
+        uint32_t count = TRUE_COUNT[ci]++;
+        if (count == 0) {
+            false_remove(ci);
+            BREAK[v]++;
+        } else if (count == 1) {
+            BREAK[TRUE_XOR[ci]]--;
+        }
+        TRUE_XOR[ci] ^= v;
+    }
+    occ = OCC + OCC_START[-now_true + N_VARS];
+    occ_end = OCC + OCC_START[-now_true + N_VARS + 1];
+    for (; occ < occ_end; ++occ) {
+        size_t ci = *occ;
+        uint32_t count = --TRUE_COUNT[ci];
+        TRUE_XOR[ci] ^= v;
+        if (count == 0) {
+            false_add(ci);
+            BREAK[v]--;
+        } else if (count == 1) {
+            BREAK[TRUE_XOR[ci]]++;
+        }
+    }
+}
+
+// Desc: ProbSAT: variable of clause with probability falling with its break count
+// Returns 0 if all variables of clause are fixed
+static int32_t
+sls_pick_probsat(const Clause *c, double *prob) {
+    double sum = 0;
+    for (size_t j = 0; j < c->size; ++j) {
+        int32_t v = c->lits[j] > 0 ? c->lits[j] : -c->lits[j];
+        uint32_t b = BREAK[v] < SLS_MAX_BREAK ? BREAK[v] : SLS_MAX_BREAK;
+        prob[j] = FIXED[v] ? 0 : PROB[b];
+        sum += prob[j];
+    }
+    if (sum == 0) {
+        return 0;
+    }
+    double r = sls_rand_unit() * sum;
+    size_t last = 0;
+    for (size_t j = 0; j < c->size; ++j) {
+        if (prob[j] == 0) {
+            continue;
+        }
+        last = j;
+        r -= prob[j];
+        if (r <= 0) {
+            break;
+        }
+    }
+    return c->lits[last] > 0 ? c->lits[last] : -c->lits[last];
+}
+
+// Desc: WalkSAT: free move if there is one, else random variable with noise probability
+// or the one breaking fewest clauses
+// Returns 0 if all variables of clause are fixed
+static int32_t
+sls_pick_walksat(const Clause *c) {
+    int32_t best = 0;
+    uint32_t best_break = UINT32_MAX;
+    size_t free_vars = 0, ties = 0;
+    for (size_t j = 0; j < c->size; ++j) {
+        int32_t v = c->lits[j] > 0 ? c->lits[j] : -c->lits[j];
+        if (FIXED[v]) {
+            continue;
+        }
+        free_vars++;
+        // Ties are broken at random, else search cycles
+        if (BREAK[v] < best_break) {
+            best_break = BREAK[v];
+            best = v;
+            ties = 1;
+        } else if (BREAK[v] == best_break && sls_rand() % ++ties == 0) {
+            best = v;
+        }
+    }
+    if (best_break == 0 || !free_vars || sls_rand_unit() >= SLS_WALK_NOISE) {
+        return best;
+    }
+    size_t k = sls_rand() % free_vars;
+    for (size_t j = 0; j < c->size; ++j) {
+        int32_t v = c->lits[j] > 0 ? c->lits[j] : -c->lits[j];
+        if (!FIXED[v] && k-- == 0) {
+            return v;
+        }
+    }
+    assert(0);
+}
+
+SolverRes
+sls_solve(const Formula *f, Tetrits root, Tetrits best, double seconds, uint64_t seed) {
+    double start = sls_now();
+    sls_load(f);
+    SEED = seed ? seed : 0x9e3779b97f4a7c15ull;
+    VALUE = malloc(N_VARS + 1);
+    FIXED = calloc(N_VARS + 1, 1);
+    size_t max_size = 0;
+    for (size_t ci = 0; ci < N_CLAUSES; ++ci) {
+        max_size = CLAUSES[ci]->size > max_size ? CLAUSES[ci]->size : max_size;
+    }
+    for (size_t b = 0; b <= SLS_MAX_BREAK; ++b) {
+        if (max_size <= 3) {
+            PROB[b] = pow(SLS_POLY_EPS + b, -SLS_POLY_CB);
+        } else {
+            PROB[b] = pow(max_size <= 5 ? SLS_EXP_CB_5 : SLS_EXP_CB_7, -(double)b);
+        }
+    }
+    double *prob = malloc((max_size ? max_size : 1) * sizeof(*prob));
+
+    // Random start, root assignments stay
+    for (size_t v = 1; v <= N_VARS; ++v) {
+        State st = get(root, v);
+        FIXED[v] = st != UNSET;
+        VALUE[v] = st == UNSET ? sls_rand() >> 63 : st == TRUE;
+    }
+    TRUE_COUNT = calloc(N_CLAUSES ? N_CLAUSES : 1, sizeof(*TRUE_COUNT));
+    TRUE_XOR = calloc(N_CLAUSES ? N_CLAUSES : 1, sizeof(*TRUE_XOR));
+    BREAK = calloc(N_VARS + 1, sizeof(*BREAK));
+    FALSE_LIST = malloc((N_CLAUSES ? N_CLAUSES : 1) * sizeof(*FALSE_LIST));
+    FALSE_POS = malloc((N_CLAUSES ? N_CLAUSES : 1) * sizeof(*FALSE_POS));
+    N_FALSE = 0;
+    for (size_t ci = 0; ci < N_CLAUSES; ++ci) {
+        for (size_t j = 0; j < CLAUSES[ci]->size; ++j) {
+            int32_t lit = CLAUSES[ci]->lits[j];
+            if (lit_true(lit)) {
+                TRUE_COUNT[ci]++;
+                TRUE_XOR[ci] ^= lit > 0 ? lit : -lit;
+            }
+        }
+        if (TRUE_COUNT[ci] == 0) {
+            false_add(ci);
+        } else if (TRUE_COUNT[ci] == 1) {
+            BREAK[TRUE_XOR[ci]]++;
+        }
+    }
+
+    // Best assignment is kept as snapshot and flips made since then, snapshot catches up
+    // when the log grows long, so saving it costs O(1) per flip
+    char *snapshot = malloc(N_VARS + 1);
+    memcpy(snapshot, VALUE, N_VARS + 1);
+    int32_t *log = malloc((2 * N_VARS + 1) * sizeof(*log));
+    size_t log_size = 0, best_mark = 0, best_unsat = N_FALSE;
+    uint64_t flips = 0;
+    int stuck = 0;
+    while (N_FALSE && !stuck) {
+        if ((flips & (SLS_CHECK_FLIPS - 1)) == 0 && flips
+                && (atomic_load_explicit(&STOP, memory_order_relaxed)
+                    || (seconds > 0 && sls_now() - start >= seconds))) {
+            break;
+        }
+        const Clause *c = CLAUSES[FALSE_LIST[sls_rand() % N_FALSE]];
+        int32_t v = WALKSAT ? sls_pick_walksat(c) : sls_pick_probsat(c, prob);
+        if (!v) {
+            // Clause is falsified by root, search refutes it at once
+            stuck = 1;
+            break;
+        }
+        sls_flip(v);
+        flips++;
+        log[log_size++] = v;
+        if (N_FALSE < best_unsat) {
+            best_unsat = N_FALSE;
+            best_mark = log_size;
+        }
+        if (log_size > 2 * N_VARS) {
+            // Flips commute, so the rest of the log is replaced by the difference to current assignment
+            for (size_t k = 0; k < best_mark; ++k) {
+                snapshot[log[k]] ^= 1;
+            }
+            log_size = best_mark = 0;
+            for (size_t u = 1; u <= N_VARS; ++u) {
+                if (snapshot[u] != VALUE[u]) {
+                    log[log_size++] = u;
+                }
+            }
+        }
+    }
+    for (size_t k = 0; k < best_mark; ++k) {
+        snapshot[log[k]] ^= 1;
+    }
+    for (size_t v = 1; v <= N_VARS; ++v) {
+        set(best, snapshot[v] ? (int32_t)v : -(int32_t)v);
+    }
+    double time = sls_now() - start;
+    fprintf(stderr, "c sls: %lu flips in %.2f s (%.0f/s), best %lu of %lu clauses unsatisfied\n",
+            flips, time, time > 0 ? flips / time : 0.0, best_unsat, N_CLAUSES);
+    free(snapshot);
+    free(log);
+    free(prob);
+    sls_unload();
+    return best_unsat == 0 ? SAT : UNKNOWN;
+}
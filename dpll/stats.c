@@ -0,0 +1,178 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <assert.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include "dpll.h"
+
+// Stats of all solvers, published by them and summed up by reports
+static Stats *ALL;
+static pthread_mutex_t LOCK = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t REPORTER;
+static atomic_int DONE;
+static double START;
+static double INTERVAL;
+
+// Sum over solvers, depth and stack are the largest ones
+typedef struct Totals {
+    double time;
+    uint64_t decisions;
+    uint64_t propagations;
+    uint64_t conflicts;
+    uint64_t restarts;
+    uint64_t learned;
+    uint64_t depth;
+    uint64_t stack;
+} Totals;
+
+static double
+stats_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static Totals
+stats_sum(void) {
+    Totals t = {stats_now() - START};
+    pthread_mutex_lock(&LOCK);
+    for (Stats *st = ALL; st; st = st->next) {
+        t.decisions += atomic_load_explicit(&st->decisions, memory_order_relaxed);
+        t.propagations += atomic_load_explicit(&st->propagations, memory_order_relaxed);
+        t.conflicts += atomic_load_explicit(&st->conflicts, memory_order_relaxed);
+        t.restarts += atomic_load_explicit(&st->restarts, memory_order_relaxed);
+        t.learned += atomic_load_explicit(&st->learned, memory_order_relaxed);
+        uint64_t depth = atomic_load_explicit(&st->depth, memory_order_relaxed);
+        uint64_t stack = atomic_load_explicit(&st->stack, memory_order_relaxed);
+        t.depth = depth > t.depth ? depth : t.depth;
+        t.stack = stack > t.stack ? stack : t.stack;
+    }
+    pthread_mutex_unlock(&LOCK);
+    return t;
+}
+
+static double
+stats_rate(uint64_t count, double time) {
+    return time > 0 ? count / time : 0;
+}
+
+static void
+stats_print_json(const char *result) {
+    Totals t = stats_sum();
+    fprintf(stderr,
+            "{\n"
+            "  \"result\": \"%s\",\n"
+            "  \"time\": %.3f,\n"
+            "  \"decisions\": %lu,\n"
+            "  \"propagations\": %lu,\n"
+            "  \"conflicts\": %lu,\n"
+            "  \"restarts\": %lu,\n"
+            "  \"learned\": %lu,\n"
+            "  \"depth\": %lu,\n"
+            "  \"stack\": %lu,\n"
+            "  \"decisions_per_sec\": %.1f,\n"
+            "  \"propagations_per_sec\": %.1f,\n"
+            "  \"conflicts_per_sec\": %.1f\n"
+            "}\n",
+            result, t.time, t.decisions, t.propagations, t.conflicts, t.restarts, t.learned, t.depth, t.stack,
+            stats_rate(t.decisions, t.time), stats_rate(t.propagations, t.time), stats_rate(t.conflicts, t.time));
+}
+
+// Desc: one line of current totals, rates are over the time since previous line
+static void
+stats_progress(Totals *prev) {
+    Totals t = stats_sum();
+    double dt = t.time - prev->time;
+    fprintf(stderr, "c progress: %.1f s, decisions %lu (%.0f/s), conflicts %lu (%.0f/s), "
+            "propagations %lu (%.0f/s), restarts %lu, learned %lu, depth %lu, stack %lu\n",
+            t.time, t.decisions, stats_rate(t.decisions - prev->decisions, dt),
+            t.conflicts, stats_rate(t.conflicts - prev->conflicts, dt),
+            t.propagations, stats_rate(t.propagations - prev->propagations, dt),
+            t.restarts, t.learned, t.depth, t.stack);
+    *prev = t;
+}
+
+// Desc: wait for signals and report times; signals are blocked in all threads, so only this one takes them
+static void *
+stats_reporter(void *arg) {
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGINT);
+    sigaddset(&set, SIGUSR1);
+    Totals prev = {0};
+    double next = START + INTERVAL;
+    while (!atomic_load(&DONE)) {
+        struct timespec ts, *timeout = NULL;
+        if (INTERVAL > 0) {
+            double left = next - stats_now();
+            left = left > 0 ? left : 0;
+            ts.tv_sec = left;
+            ts.tv_nsec = (left - ts.tv_sec) * 1e9;
+            timeout = &ts;
+        }
+        int sig = sigtimedwait(&set, NULL, timeout);
+        if (atomic_load(&DONE)) {
+            break;
+        }
+        if (sig == SIGINT) {
+            if (atomic_exchange(&STOP, 1)) {
+                // Second interrupt, search does not stop
+                fprintf(stderr, "c interrupted twice, exiting\n");
+                _exit(1);
+            }
+            fprintf(stderr, "c interrupted\n");
+        } else if (sig == SIGUSR1) {
+            stats_print_json("RUNNING");
+        }
+        if (INTERVAL > 0 && stats_now() >= next) {
+            stats_progress(&prev);
+            next += INTERVAL;
+        }
+    }
+    return NULL;
+}
+
+Stats *
+stats_alloc(void) {
+    Stats *st = calloc(1, sizeof(*st));
+    assert(st);
+    pthread_mutex_lock(&LOCK);
+    st->next = ALL;
+    ALL = st;
+    pthread_mutex_unlock(&LOCK);
+    return st;
+}
+
+void
+stats_start(double interval) {
+    START = stats_now();
+    INTERVAL = interval;
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGINT);
+    sigaddset(&set, SIGUSR1);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+    if (pthread_create(&REPORTER, NULL, stats_reporter, NULL)) {
+        fprintf(stderr, "Failed to start stats thread\n");
+        exit(1);
+    }
+}
+
+void
+stats_finish(SolverRes res) {
+    static const char *names[] = {"SAT", "UNSAT", "UNKNOWN"};
+    atomic_store(&DONE, 1);
+    // Wake reporter, it checks DONE first
+    pthread_kill(REPORTER, SIGUSR1);
+    pthread_join(REPORTER, NULL);
+    stats_print_json(names[res]);
+    while (ALL) {
+        Stats *next = ALL->next;
+        free(ALL);
+        ALL = next;
+    }
+}
@@ -0,0 +1,524 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <assert.h>
+#include "dpll.h"
+
+// Symmetry tuning
+#define SYM_MAX_VERTICES 1000000    // larger graphs are not searched
+#define SYM_WORK 300000000ull       // refinement steps over the whole search
+#define SYM_MAX_PATH 100000000ull   // vertices times depth of the stored first path
+#define SYM_MAX_GENERATORS 512
+#define SYM_LEX_LENGTH 64           // support variables compared by lex-leader clauses of one generator
+
+// Graph of the formula: vertex 2k and 2k + 1 are literals of k-th occurring variable, positive and
+// negative, joined by an edge; clause vertices follow and are joined with their literals.
+// Literals and clauses have different colors, so automorphisms map literals to literals consistently
+static size_t V;
+static size_t N_LIT;
+static size_t *ADJ_START;
+static uint32_t *ADJ;
+static int32_t *LIT_OF;       // literal of literal vertex
+static uint64_t WORK;
+
+// Refinement scratch
+static uint64_t *SIG;
+static uint32_t *ORDER;
+static uint32_t *COUNT_L, *COUNT_R;
+
+// First path of the search: colors after individualizing first vertex of first non-singleton cell
+typedef struct Level {
+    uint32_t *col;
+    uint32_t n_colors;
+    uint64_t trace;      // of refinement which gave col
+    uint32_t cell;       // color of individualized cell
+    uint32_t vertex;     // vertex individualized on the first path
+} Level;
+
+static Level *PATH;
+static size_t DEPTH;
+
+static uint32_t *PARENT;      // orbits of found generators, union-find
+static uint32_t *SIGMA;       // automorphism found by last successful search
+
+static uint64_t
+mix(uint64_t x) {
+    // splitmix64 finalizer
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+static int
+sig_cmp(const void *l, const void *r) {
+    uint32_t a = *(const uint32_t *)l, b = *(const uint32_t *)r;
+    return (SIG[a] > SIG[b]) - (SIG[a] < SIG[b]);
+}
+
+// Desc: split cells by colors of neighbors until stable. New colors are numbered in order of
+// (old color, neighbor signature), so isomorphic colored graphs get corresponding colors and the
+// same trace, a hash of the sequence of new cells
+// Returns 0 if work budget is exhausted
+static int
+sym_refine(uint32_t *col, uint32_t *n_colors, uint64_t *trace) {
+    // Vertices by color; renumbering keeps the order, so only cells which split are sorted again
+    memset(COUNT_R, 0, (*n_colors + 1) * sizeof(*COUNT_R));
+    for (size_t v = 0; v < V; ++v) {
+        COUNT_R[col[v] + 1]++;
+    }
+    for (size_t c = 0; c < *n_colors; ++c) {
+        COUNT_R[c + 1] += COUNT_R[c];
+    }
+    for (size_t v = 0; v < V; ++v) {
+        ORDER[COUNT_R[col[v]]++] = v;
+    }
+    while (WORK < SYM_WORK) {
+        for (size_t v = 0; v < V; ++v) {
+            uint64_t acc = 0;
+            for (size_t k = ADJ_START[v]; k < ADJ_START[v + 1]; ++k) {
+                acc += mix(col[ADJ[k]]);
+            }
+            SIG[v] = acc;
+        }
+        WORK += ADJ_START[V] + V;
+        for (size_t start = 0, end; start < V; start = end) {
+            int split = 0;
+            for (end = start + 1; end < V && col[ORDER[end]] == col[ORDER[start]]; ++end) {
+                split |= SIG[ORDER[end]] != SIG[ORDER[start]];
+            }
+            if (split) {
+                qsort(ORDER + start, end - start, sizeof(*ORDER), sig_cmp);
+                WORK += (end - start) * 20;
+            }
+        }
+        uint32_t colors = 0;
+        uint32_t prev_col = 0;
+        uint64_t prev_sig = 0;
+        // Signature of a vertex is not read after its new color is stored over it
+        for (size_t i = 0; i < V; ++i) {
+            uint32_t v = ORDER[i];
+            if (i == 0 || col[v] != prev_col || SIG[v] != prev_sig) {
+                colors++;
+                prev_col = col[v];
+                prev_sig = SIG[v];
+                *trace = mix(*trace ^ prev_sig ^ ((uint64_t)prev_col << 32 | colors));
+            }
+            SIG[v] = colors - 1;
+        }
+        for (size_t v = 0; v < V; ++v) {
+            col[v] = SIG[v];
+        }
+        if (colors == *n_colors) {
+            return 1;
+        }
+        *n_colors = colors;
+    }
+    return 0;
+}
+
+// Desc: give vertex its own color, largest one
+static void
+sym_individualize(uint32_t *col, uint32_t *n_colors, uint32_t v) {
+    col[v] = (*n_colors)++;
+}
+
+// Returns 1 if both colorings have the same cell sizes
+static int
+sym_compatible(const Level *l, const uint32_t *col, uint32_t n_colors) {
+    if (l->n_colors != n_colors) {
+        return 0;
+    }
+    memset(COUNT_L, 0, n_colors * sizeof(*COUNT_L));
+    memset(COUNT_R, 0, n_colors * sizeof(*COUNT_R));
+    for (size_t v = 0; v < V; ++v) {
+        COUNT_L[l->col[v]]++;
+        COUNT_R[col[v]]++;
+    }
+    return !memcmp(COUNT_L, COUNT_R, n_colors * sizeof(*COUNT_L));
+}
+
+static int
+adj_has(uint32_t u, uint32_t w) {
+    size_t lo = ADJ_START[u], hi = ADJ_START[u + 1];
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (ADJ[mid] < w) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo < ADJ_START[u + 1] && ADJ[lo] == w;
+}
+
+// Desc: map vertices of left color c to vertices of right color c: vertices having color c on
+// both sides stay, the others are paired in index order. For colorings at the end of the path
+// that is the mapping up to equal clauses, for others a guess that mostly holds for
+// automorphisms moving few vertices
+// Returns 1 if it is an automorphism, stored into SIGMA
+static int
+sym_check(const Level *l, const uint32_t *col, uint32_t n_colors) {
+    memset(COUNT_R, 0, (n_colors + 1) * sizeof(*COUNT_R));
+    for (size_t v = 0; v < V; ++v) {
+        if (col[v] != l->col[v]) {
+            COUNT_R[col[v] + 1]++;
+        }
+    }
+    for (size_t c = 0; c < n_colors; ++c) {
+        COUNT_R[c + 1] += COUNT_R[c];
+    }
+    for (size_t v = 0; v < V; ++v) {
+        if (col[v] != l->col[v]) {
+            ORDER[COUNT_R[col[v]]++] = v;
+        }
+    }
+    // COUNT_R[c] is now the end of right-only vertices of color c, left ones are taken from start
+    memset(COUNT_L, 0, (n_colors + 1) * sizeof(*COUNT_L));
+    for (size_t v = 0; v < V; ++v) {
+        if (col[v] != l->col[v]) {
+            COUNT_L[l->col[v] + 1]++;
+        }
+    }
+    for (size_t c = 0; c < n_colors; ++c) {
+        COUNT_L[c + 1] += COUNT_L[c];
+    }
+    for (size_t v = 0; v < V; ++v) {
+        SIGMA[v] = col[v] == l->col[v] ? v : ORDER[COUNT_L[l->col[v]]++];
+    }
+    WORK += ADJ_START[V] + 4 * V;
+    for (size_t v = 0; v < V; ++v) {
+        if (ADJ_START[v + 1] - ADJ_START[v] != ADJ_START[SIGMA[v] + 1] - ADJ_START[SIGMA[v]]) {
+            return 0;
+        }
+        for (size_t k = ADJ_START[v]; k < ADJ_START[v + 1]; ++k) {
+            if (!adj_has(SIGMA[v], SIGMA[ADJ[k]])) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+// Desc: extend right coloring at level of the first path to an automorphism, trying every
+// vertex of the cell which the first path individualizes
+// Returns 1 if automorphism is found
+static int
+sym_search(size_t level, const uint32_t *col, uint32_t n_colors, uint64_t trace) {
+    const Level *l = PATH + level;
+    if (trace != l->trace || !sym_compatible(l, col, n_colors)) {
+        return 0;
+    }
+    if (sym_check(l, col, n_colors)) {
+        return 1;
+    }
+    if (level == DEPTH) {
+        return 0;
+    }
+    uint32_t *next = malloc(V * sizeof(*next));
+    int found = 0;
+    // Automorphisms found here mostly fix the rest of the path, so its vertex is tried first
+    for (size_t k = 0; k <= V && !found && WORK < SYM_WORK; ++k) {
+        uint32_t w = k ? k - 1 : l->vertex;
+        if (col[w] != l->cell || (k && w == l->vertex)) {
+            continue;
+        }
+        memcpy(next, col, V * sizeof(*next));
+        uint32_t next_colors = n_colors;
+        uint64_t next_trace = 0;
+        sym_individualize(next, &next_colors, w);
+        if (sym_refine(next, &next_colors, &next_trace)) {
+            found = sym_search(level + 1, next, next_colors, next_trace);
+        }
+    }
+    free(next);
+    return found;
+}
+
+static uint32_t
+orbit_find(uint32_t v) {
+    while (PARENT[v] != v) {
+        PARENT[v] = PARENT[PARENT[v]];
+        v = PARENT[v];
+    }
+    return v;
+}
+
+static int
+vertex_cmp(const void *l, const void *r) {
+    uint32_t a = *(const uint32_t *)l, b = *(const uint32_t *)r;
+    return (a > b) - (a < b);
+}
+
+// Desc: build graph of clauses of f over occurring variables
+// Returns 0 if the graph is too large
+static int
+sym_graph(const Formula *f) {
+    int32_t *compact = calloc(f->n_vars + 1, sizeof(*compact));
+    size_t n_occ = 0, n_edges = 0;
+    for (size_t i = 0; i < f->n_clauses; ++i) {
+        for (size_t j = 0; j < f->clauses[i].size; ++j) {
+            int32_t var = f->clauses[i].lits[j] > 0 ? f->clauses[i].lits[j] : -f->clauses[i].lits[j];
+            if (!compact[var]) {
+                compact[var] = ++n_occ;
+            }
+        }
+        n_edges += 2 * f->clauses[i].size;
+    }
+    N_LIT = 2 * n_occ;
+    V = N_LIT + f->n_clauses;
+    if (V > SYM_MAX_VERTICES || V == 0) {
+        free(compact);
+        return 0;
+    }
+    n_edges += 2 * n_occ;
+    LIT_OF = malloc(N_LIT * sizeof(*LIT_OF));
+    for (size_t var = 1; var <= f->n_vars; ++var) {
+        if (compact[var]) {
+            LIT_OF[2 * (compact[var] - 1)] = var;
+            LIT_OF[2 * (compact[var] - 1) + 1] = -(int32_t)var;
+        }
+    }
+    ADJ_START = calloc(V + 1, sizeof(*ADJ_START));
+    for (size_t k = 0; k < n_occ; ++k) {
+        ADJ_START[2 * k + 1]++;
+        ADJ_START[2 * k + 2]++;
+    }
+    for (size_t i = 0; i < f->n_clauses; ++i) {
+        for (size_t j = 0; j < f->clauses[i].size; ++j) {
+            int32_t lit = f->clauses[i].lits[j];
+            size_t lv = 2 * (compact[lit > 0 ? lit : -lit] - 1) + (lit < 0);
+            ADJ_START[lv + 1]++;
+            ADJ_START[N_LIT + i + 1]++;
+        }
+    }
+    for (size_t v = 0; v < V; ++v) {
+        ADJ_START[v + 1] += ADJ_START[v];
+    }
+    ADJ = malloc((n_edges ? n_edges : 1) * sizeof(*ADJ));
+    size_t *fill = malloc(V * sizeof(*fill));
+    memcpy(fill, ADJ_START, V * sizeof(*fill));
+    for (size_t k = 0; k < n_occ; ++k) {
+        ADJ[fill[2 * k]++] = 2 * k + 1;
+        ADJ[fill[2 * k + 1]++] = 2 * k;
+    }
+    for (size_t i = 0; i < f->n_clauses; ++i) {
+        for (size_t j = 0; j < f->clauses[i].size; ++j) {
+            int32_t lit = f->clauses[i].lits[j];
+            size_t lv = 2 * (compact[lit > 0 ? lit : -lit] - 1) + (lit < 0);
+            ADJ[fill[lv]++] = N_LIT + i;
+            ADJ[fill[N_LIT + i]++] = lv;
+        }
+    }
+    // Sorted lists for automorphism check; duplicate literals of a clause are harmless there
+    for (size_t v = 0; v < V; ++v) {
+        qsort(ADJ + ADJ_START[v], ADJ_START[v + 1] - ADJ_START[v], sizeof(*ADJ), vertex_cmp);
+    }
+    free(fill);
+    free(compact);
+    return 1;
+}
+
+// Returns image of literal under permutation of variables to literals, 0 is identity
+static int32_t
+sym_apply(const int32_t *image, int32_t lit) {
+    int32_t var = lit > 0 ? lit : -lit;
+    if (!image[var]) {
+        return lit;
+    }
+    return lit > 0 ? image[var] : -image[var];
+}
+
+// Desc: add lex-leader clauses x <= sigma(x) over support of generator in variable order.
+// e_i is implied when x and sigma(x) are equal on the first i compared variables
+// Image of variables up to n_vars is given, 0 for variables not in clauses
+// Returns number of added clauses
+static size_t
+sym_lex_leader(Formula *f, const int32_t *image, size_t n_vars) {
+    size_t added = 0, compared = 0;
+    int32_t eq = 0;
+    for (size_t var = 1; var <= n_vars && compared < SYM_LEX_LENGTH; ++var) {
+        int32_t y = image[var];
+        if (!y || y == (int32_t)var) {
+            continue;
+        }
+        int32_t x = var;
+        compared++;
+        int32_t lits[3];
+        size_t n = 0;
+        if (eq) {
+            lits[n++] = -eq;
+        }
+        lits[n++] = -x;
+        if (y != -x) {
+            lits[n++] = y;
+        }
+        formula_add(f, lits, n);
+        added++;
+        if (y == -x || compared == SYM_LEX_LENGTH) {
+            // Equality can not hold past this variable
+            break;
+        }
+        int32_t next = f->n_vars + 1;
+        n = 0;
+        if (eq) {
+            lits[n++] = -eq;
+        }
+        lits[n] = -x;
+        lits[n + 1] = next;
+        formula_add(f, lits, n + 2);
+        lits[n] = y;
+        formula_add(f, lits, n + 2);
+        added += 2;
+        eq = next;
+    }
+    return added;
+}
+
+void
+symmetry_break(Formula *f) {
+    if (!sym_graph(f)) {
+        return;
+    }
+    WORK = 0;
+    SIG = malloc(V * sizeof(*SIG));
+    ORDER = malloc(V * sizeof(*ORDER));
+    COUNT_L = malloc((V + 1) * sizeof(*COUNT_L));
+    COUNT_R = malloc((V + 1) * sizeof(*COUNT_R));
+    SIGMA = malloc(V * sizeof(*SIGMA));
+    PARENT = malloc(V * sizeof(*PARENT));
+    for (size_t v = 0; v < V; ++v) {
+        PARENT[v] = v;
+    }
+
+    // First path: individualize first vertex of first non-singleton cell of literals until every
+    // literal has its own color. Clauses left in one cell then have equal literals, any of their
+    // pairings is an automorphism and mapping them is left to sym_check
+    size_t path_cap = 16;
+    PATH = malloc(path_cap * sizeof(*PATH));
+    uint32_t *col = malloc(V * sizeof(*col));
+    uint32_t n_colors = 2;
+    for (size_t v = 0; v < V; ++v) {
+        col[v] = v >= N_LIT;
+    }
+    uint64_t trace = 0;
+    int complete = sym_refine(col, &n_colors, &trace);
+    DEPTH = 0;
+    while (complete) {
+        if (DEPTH == path_cap) {
+            path_cap *= 2;
+            PATH = realloc(PATH, path_cap * sizeof(*PATH));
+        }
+        Level *l = PATH + DEPTH;
+        l->col = col;
+        l->n_colors = n_colors;
+        l->trace = trace;
+        memset(COUNT_L, 0, n_colors * sizeof(*COUNT_L));
+        for (size_t v = 0; v < N_LIT; ++v) {
+            COUNT_L[col[v]]++;
+        }
+        l->cell = 0;
+        while (l->cell < n_colors && COUNT_L[l->cell] < 2) {
+            l->cell++;
+        }
+        if (l->cell == n_colors) {
+            break;
+        }
+        if ((DEPTH + 1) * (uint64_t)V > SYM_MAX_PATH) {
+            complete = 0;
+            break;
+        }
+        l->vertex = 0;
+        while (col[l->vertex] != l->cell) {
+            l->vertex++;
+        }
+        uint32_t *next = malloc(V * sizeof(*next));
+        memcpy(next, col, V * sizeof(*next));
+        sym_individualize(next, &n_colors, l->vertex);
+        trace = 0;
+        complete = sym_refine(next, &n_colors, &trace);
+        col = next;
+        DEPTH++;
+    }
+
+    // Generators of stabilizers, deepest level first: every generator found so far fixes vertices
+    // of the path above the level, so their orbits prune candidates
+    size_t n_gens = 0, added = 0, vars_before = f->n_vars;
+    int32_t *image = calloc(f->n_vars + 1, sizeof(*image));
+    int32_t *prev = calloc(f->n_vars + 1, sizeof(*prev));
+    int32_t *conj = calloc(f->n_vars + 1, sizeof(*conj));
+    uint32_t *right = malloc(V * sizeof(*right));
+    for (size_t level = DEPTH; complete && level-- > 0 && n_gens < SYM_MAX_GENERATORS;) {
+        const Level *l = PATH + level;
+        int has_prev = 0;
+        for (size_t w = 0; w < V && n_gens < SYM_MAX_GENERATORS; ++w) {
+            if (WORK >= SYM_WORK) {
+                complete = 0;
+                break;
+            }
+            if (l->col[w] != l->cell || orbit_find(w) == orbit_find(l->vertex)) {
+                continue;
+            }
+            memcpy(right, l->col, V * sizeof(*right));
+            uint32_t right_colors = l->n_colors;
+            uint64_t right_trace = 0;
+            sym_individualize(right, &right_colors, w);
+            if (!sym_refine(right, &right_colors, &right_trace)
+                    || !sym_search(level + 1, right, right_colors, right_trace)) {
+                continue;
+            }
+            for (size_t v = 0; v < V; ++v) {
+                PARENT[orbit_find(v)] = orbit_find(SIGMA[v]);
+            }
+            // Variables are compared in their order, image of a literal vertex is a literal
+            memset(image, 0, (vars_before + 1) * sizeof(*image));
+            int moved = 0;
+            for (size_t v = 0; v < N_LIT; v += 2) {
+                image[LIT_OF[v]] = LIT_OF[SIGMA[v]];
+                moved |= SIGMA[v] != v;
+            }
+            if (!moved) {
+                // Swaps equal clauses only
+                continue;
+            }
+            n_gens++;
+            added += sym_lex_leader(f, image, vars_before);
+            // Generators of one level move the path vertex to other vertices of its cell. For
+            // interchangeable objects that gives a star of swaps, whose lex-leader clauses order
+            // only the first object; conjugate of the next by the previous one swaps neighbours
+            if (has_prev) {
+                for (size_t var = 1; var <= vars_before; ++var) {
+                    conj[var] = image[var] ? sym_apply(prev, sym_apply(image, sym_apply(prev, var))) : 0;
+                }
+                added += sym_lex_leader(f, conj, vars_before);
+            }
+            memcpy(prev, image, (vars_before + 1) * sizeof(*prev));
+            has_prev = 1;
+        }
+    }
+    fprintf(stderr, "c symmetry: %lu vertices, depth %lu, %lu generators, %lu clauses, %lu variables added%s\n",
+            V, DEPTH, n_gens, added, f->n_vars - vars_before, complete ? "" : ", search stopped");
+
+    for (size_t i = 0; i < DEPTH + complete; ++i) {
+        free(PATH[i].col);
+    }
+    if (!complete) {
+        // Last coloring of an interrupted path is not stored
+        free(col);
+    }
+    free(PATH);
+    free(image);
+    free(prev);
+    free(conj);
+    free(right);
+    free(SIG);
+    free(ORDER);
+    free(COUNT_L);
+    free(COUNT_R);
+    free(SIGMA);
+    free(PARENT);
+    free(ADJ_START);
+    free(ADJ);
+    free(LIT_OF);
+}
@@ -0,0 +1,364 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <assert.h>
+#include "dpll.h"
+
+// XOR tuning
+#define XOR_DETECT_MAX 6          // longest clauses searched for hidden XORs, they need 2^(k-1) clauses
+#define XOR_MATRIX_BITS (1ull << 28) // largest matrix, every solver keeps a copy
+
+#define NO_PIVOT SIZE_MAX
+
+// XOR constraints as a matrix over GF(2) in reduced row echelon form, rows packed in 64-bit words.
+// Pivot column of a row appears in no other row
+struct Gauss {
+    size_t n_rows;
+    size_t n_cols;
+    size_t words;        // words per row
+    int32_t *col_var;    // variable of column
+    uint64_t *rows;
+    char *rhs;
+    size_t *pivot;
+};
+
+#define BIT(row, col) (((row)[(col) / 64] >> ((col) % 64)) & 1)
+
+void
+formula_add_xor(Formula *f, const int32_t *lits, size_t size) {
+    if (f->n_xors == f->xors_cap) {
+        f->xors_cap = f->xors_cap ? 2 * f->xors_cap : 16;
+        f->xors = realloc(f->xors, f->xors_cap * sizeof(*f->xors));
+    }
+    Xor *x = f->xors + f->n_xors++;
+    x->vars = malloc((size ? size : 1) * sizeof(*x->vars));
+    x->size = 0;
+    x->rhs = 1;
+    for (size_t i = 0; i < size; ++i) {
+        int32_t var = lits[i] > 0 ? lits[i] : -lits[i];
+        x->rhs ^= lits[i] < 0;
+        f->n_vars = (size_t)var > f->n_vars ? (size_t)var : f->n_vars;
+        // Repeated variable cancels out
+        size_t j = 0;
+        while (j < x->size && x->vars[j] != var) {
+            j++;
+        }
+        if (j < x->size) {
+            x->vars[j] = x->vars[--x->size];
+        } else {
+            x->vars[x->size++] = var;
+        }
+    }
+}
+
+// Order clauses by size, then by sorted variables
+static const Formula *SORTED;
+static int32_t *KEYS;         // sorted variables of clause i at KEYS + i * XOR_DETECT_MAX
+
+static int
+xor_key_cmp(const void *l, const void *r) {
+    size_t a = *(const size_t *)l, b = *(const size_t *)r;
+    size_t sa = SORTED->clauses[a].size, sb = SORTED->clauses[b].size;
+    if (sa != sb) {
+        return sa < sb ? -1 : 1;
+    }
+    int c = memcmp(KEYS + a * XOR_DETECT_MAX, KEYS + b * XOR_DETECT_MAX, sa * sizeof(*KEYS));
+    return c ? c : (a > b) - (a < b);
+}
+
+static int
+var_cmp(const void *l, const void *r) {
+    int32_t a = *(const int32_t *)l, b = *(const int32_t *)r;
+    return (a > b) - (a < b);
+}
+
+size_t
+xor_detect(Formula *f) {
+    size_t n = f->n_clauses, n_cand = 0;
+    size_t *cand = malloc((n ? n : 1) * sizeof(*cand));
+    KEYS = malloc((n ? n : 1) * XOR_DETECT_MAX * sizeof(*KEYS));
+    SORTED = f;
+    for (size_t i = 0; i < n; ++i) {
+        Clause c = f->clauses[i];
+        if (c.size < 3 || c.size > XOR_DETECT_MAX) {
+            continue;
+        }
+        int32_t *key = KEYS + i * XOR_DETECT_MAX;
+        for (size_t j = 0; j < c.size; ++j) {
+            key[j] = c.lits[j] > 0 ? c.lits[j] : -c.lits[j];
+        }
+        qsort(key, c.size, sizeof(*key), var_cmp);
+        int repeated = 0;
+        for (size_t j = 1; j < c.size; ++j) {
+            repeated |= key[j] == key[j - 1];
+        }
+        if (!repeated) {
+            cand[n_cand++] = i;
+        }
+    }
+    qsort(cand, n_cand, sizeof(*cand), xor_key_cmp);
+
+    // Clauses of one variable set, by pattern of negated variables: XOR of parity r forbids every
+    // assignment of the other parity, so it is all 2^(k-1) patterns with number of negations != r
+    char *removed = calloc(n ? n : 1, 1);
+    size_t found = 0;
+    size_t *by_pattern = malloc((1u << XOR_DETECT_MAX) * sizeof(*by_pattern));
+    for (size_t g = 0; g < n_cand;) {
+        size_t end = g + 1, k = f->clauses[cand[g]].size;
+        const int32_t *key = KEYS + cand[g] * XOR_DETECT_MAX;
+        while (end < n_cand && f->clauses[cand[end]].size == k
+                && !memcmp(KEYS + cand[end] * XOR_DETECT_MAX, key, k * sizeof(*key))) {
+            end++;
+        }
+        if (end - g < (1u << (k - 1))) {
+            g = end;
+            continue;
+        }
+        size_t count[2] = {0, 0};
+        for (size_t p = 0; p < (1u << k); ++p) {
+            by_pattern[p] = SIZE_MAX;
+        }
+        for (size_t i = g; i < end; ++i) {
+            Clause c = f->clauses[cand[i]];
+            size_t pattern = 0;
+            for (size_t j = 0; j < k; ++j) {
+                if (c.lits[j] < 0) {
+                    const int32_t *pos = bsearch(&(int32_t){-c.lits[j]}, key, k, sizeof(*key), var_cmp);
+                    pattern |= 1u << (pos - key);
+                }
+            }
+            if (by_pattern[pattern] == SIZE_MAX) {
+                count[__builtin_popcount(pattern) & 1]++;
+            }
+            by_pattern[pattern] = cand[i];
+        }
+        for (int parity = 0; parity < 2; ++parity) {
+            if (count[parity] != (1u << (k - 1))) {
+                continue;
+            }
+            for (size_t i = g; i < end; ++i) {
+                Clause c = f->clauses[cand[i]];
+                size_t negs = 0;
+                for (size_t j = 0; j < k; ++j) {
+                    negs += c.lits[j] < 0;
+                }
+                removed[cand[i]] |= (negs & 1) == (size_t)parity;
+            }
+            // Clauses with even number of negations forbid even assignments, XOR is odd
+            int32_t lits[XOR_DETECT_MAX];
+            memcpy(lits, key, k * sizeof(*lits));
+            lits[0] = parity ? -lits[0] : lits[0];
+            formula_add_xor(f, lits, k);
+            found++;
+        }
+        g = end;
+    }
+    size_t kept = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (!removed[i]) {
+            f->clauses[kept++] = f->clauses[i];
+        }
+    }
+    f->n_clauses = kept;
+    free(by_pattern);
+    free(removed);
+    free(cand);
+    free(KEYS);
+    KEYS = NULL;
+    if (found) {
+        fprintf(stderr, "c xor: %lu detected in clauses\n", found);
+    }
+    return found;
+}
+
+// Desc: make row r pivot row of column p: eliminate p from all other rows
+static void
+gauss_pivot(const Gauss *g, uint64_t *rows, char *rhs, size_t r, size_t p) {
+    const uint64_t *row = rows + r * g->words;
+    for (size_t o = 0; o < g->n_rows; ++o) {
+        uint64_t *other = rows + o * g->words;
+        if (o != r && BIT(other, p)) {
+            for (size_t w = 0; w < g->words; ++w) {
+                other[w] ^= row[w];
+            }
+            rhs[o] ^= rhs[r];
+        }
+    }
+}
+
+// Returns first column set in row, NO_PIVOT if none
+static size_t
+gauss_first(const Gauss *g, const uint64_t *row) {
+    for (size_t w = 0; w < g->words; ++w) {
+        if (row[w]) {
+            return w * 64 + __builtin_ctzll(row[w]);
+        }
+    }
+    return NO_PIVOT;
+}
+
+SolverRes
+xor_build(Formula *f) {
+    if (!f->n_xors) {
+        return UNKNOWN;
+    }
+    Gauss *g = calloc(1, sizeof(*g));
+    int32_t *col_of = calloc(f->n_vars + 1, sizeof(*col_of));
+    g->col_var = malloc(f->n_vars * sizeof(*g->col_var) + 1);
+    for (size_t i = 0; i < f->n_xors; ++i) {
+        for (size_t j = 0; j < f->xors[i].size; ++j) {
+            int32_t v = f->xors[i].vars[j];
+            if (!col_of[v]) {
+                g->col_var[g->n_cols] = v;
+                col_of[v] = ++g->n_cols;
+            }
+        }
+    }
+    g->n_rows = f->n_xors;
+    g->words = (g->n_cols + 63) / 64;
+    g->words = g->words ? g->words : 1;
+    if ((uint64_t)g->n_rows * g->words * 64 > XOR_MATRIX_BITS) {
+        fprintf(stderr, "XOR matrix of %lu rows and %lu columns is too large\n", g->n_rows, g->n_cols);
+        exit(1);
+    }
+    g->rows = calloc(g->n_rows * g->words, sizeof(*g->rows));
+    g->rhs = malloc(g->n_rows);
+    g->pivot = malloc(g->n_rows * sizeof(*g->pivot));
+    for (size_t i = 0; i < f->n_xors; ++i) {
+        uint64_t *row = g->rows + i * g->words;
+        for (size_t j = 0; j < f->xors[i].size; ++j) {
+            size_t c = col_of[f->xors[i].vars[j]] - 1;
+            row[c / 64] ^= 1ull << (c % 64);
+        }
+        g->rhs[i] = f->xors[i].rhs;
+    }
+    free(col_of);
+
+    // Gauss-Jordan elimination, dependent rows become empty and are dropped
+    SolverRes res = UNKNOWN;
+    for (size_t r = 0; r < g->n_rows; ++r) {
+        g->pivot[r] = gauss_first(g, g->rows + r * g->words);
+        if (g->pivot[r] != NO_PIVOT) {
+            gauss_pivot(g, g->rows, g->rhs, r, g->pivot[r]);
+        }
+    }
+    size_t kept = 0;
+    for (size_t r = 0; r < g->n_rows; ++r) {
+        if (g->pivot[r] == NO_PIVOT) {
+            if (g->rhs[r]) {
+                res = UNSAT;
+            }
+            continue;
+        }
+        memmove(g->rows + kept * g->words, g->rows + r * g->words, g->words * sizeof(*g->rows));
+        g->rhs[kept] = g->rhs[r];
+        g->pivot[kept] = g->pivot[r];
+        kept++;
+    }
+    fprintf(stderr, "c xor: %lu constraints, %lu variables, rank %lu\n", f->n_xors, g->n_cols, kept);
+    g->n_rows = kept;
+    f->gauss = g;
+    return res;
+}
+
+void
+xor_free(Gauss *g) {
+    if (g) {
+        free(g->col_var);
+        free(g->rows);
+        free(g->rhs);
+        free(g->pivot);
+        free(g);
+    }
+}
+
+SolverRes
+xor_propagate(Solver *s, Tetrits t, int32_t *units, size_t *n_units) {
+    const Gauss *g = s->f->gauss;
+    size_t words = g->words;
+    if (!s->xor_rows) {
+        s->xor_rows = malloc((g->n_rows + 2) * words * sizeof(*s->xor_rows));
+        s->xor_rhs = malloc(g->n_rows + 1);
+        s->xor_pivot = malloc((g->n_rows + 1) * sizeof(*s->xor_pivot));
+    }
+    uint64_t *rows = s->xor_rows, *assigned = rows + g->n_rows * words, *true_mask = assigned + words;
+    char *rhs = s->xor_rhs;
+    size_t *pivot = s->xor_pivot;
+    memset(assigned, 0, 2 * words * sizeof(*assigned));
+    for (size_t c = 0; c < g->n_cols; ++c) {
+        State v = get(t, g->col_var[c]);
+        if (v != UNSET) {
+            assigned[c / 64] |= 1ull << (c % 64);
+            if (v == TRUE) {
+                true_mask[c / 64] |= 1ull << (c % 64);
+            }
+        }
+    }
+    // Assigned columns are moved into right hand side
+    memcpy(rows, g->rows, g->n_rows * words * sizeof(*rows));
+    memcpy(rhs, g->rhs, g->n_rows);
+    memcpy(pivot, g->pivot, g->n_rows * sizeof(*pivot));
+    for (size_t r = 0; r < g->n_rows; ++r) {
+        uint64_t *row = rows + r * words;
+        uint64_t parity = 0;
+        for (size_t w = 0; w < words; ++w) {
+            parity ^= row[w] & true_mask[w];
+            row[w] &= ~assigned[w];
+        }
+        rhs[r] ^= __builtin_parityll(parity);
+    }
+    // Only rows which lost their pivot are eliminated again
+    for (size_t r = 0; r < g->n_rows; ++r) {
+        if (pivot[r] == NO_PIVOT || !BIT(assigned, pivot[r])) {
+            continue;
+        }
+        pivot[r] = gauss_first(g, rows + r * words);
+        if (pivot[r] == NO_PIVOT) {
+            if (rhs[r]) {
+                return UNSAT;
+            }
+            continue;
+        }
+        gauss_pivot(g, rows, rhs, r, pivot[r]);
+    }
+    // Rows of a single column are units, none left means all constraints hold
+    int open = 0;
+    *n_units = 0;
+    for (size_t r = 0; r < g->n_rows; ++r) {
+        if (pivot[r] == NO_PIVOT) {
+            continue;
+        }
+        const uint64_t *row = rows + r * words;
+        size_t count = 0;
+        for (size_t w = 0; w < words && count < 2; ++w) {
+            count += __builtin_popcountll(row[w]);
+        }
+        if (count == 1) {
+            int32_t v = g->col_var[pivot[r]];
+            units[(*n_units)++] = rhs[r] ? v : -v;
+        } else {
+            open = 1;
+        }
+    }
+    return open || *n_units ? UNKNOWN : SAT;
+}
+
+void
+xor_score(const Formula *f, Tetrits t, double *score) {
+    for (size_t i = 0; i < f->n_xors; ++i) {
+        const Xor *x = f->xors + i;
+        size_t unset = 0;
+        for (size_t j = 0; j < x->size; ++j) {
+            unset += get(t, x->vars[j]) == UNSET;
+        }
+        if (unset < 2) {
+            continue;
+        }
+        for (size_t j = 0; j < x->size; ++j) {
+            if (get(t, x->vars[j]) == UNSET) {
+                score[x->vars[j]] += 1.0 / unset;
+            }
+        }
+    }
+}
@@ -0,0 +1,223 @@
+/*
+ * Copyright 2024 Winking-maniac (http://github.com/Winking-maniac)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except
+ * in compliance with the License. You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed under the License
+ * is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+ * or implied. See the License for the specific language governing permissions and limitations under
+ * the License.
+ */
+
+#include "cndfs.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <thread>
+
+using std::vector;
+
+namespace model::ltl {
+
+namespace {
+
+enum Color : unsigned { WHITE, CYAN, BLUE, PINK };
+
+uint64_t
+hash_key(const uint64_t *key, size_t words) {
+    uint64_t h = 0x9e3779b97f4a7c15ull;
+    for (size_t i = 0; i < words; ++i) {
+        h ^= key[i];
+        h *= 0xbf58476d1ce4e5b9ull;
+        h ^= h >> 31;
+    }
+    return h;
+}
+
+} // namespace
+
+SharedStateTable::SharedStateTable(size_t words, unsigned log2_slots):
+        words(words), mask(((size_t)1 << log2_slots) - 1),
+        tags(new std::atomic<uint32_t>[mask + 1]()), colors(new std::atomic<uint64_t>[mask + 1]()),
+        keys(new uint64_t[(mask + 1) * words]) {}
+
+std::pair<uint32_t, bool>
+SharedStateTable::insert(const uint64_t *key) {
+    uint64_t h = hash_key(key, words);
+    uint32_t tag = std::max<uint32_t>(h >> 32, 2);
+    for (size_t i = h & mask;; i = (i + 1) & mask) {
+        uint32_t t = tags[i].load(std::memory_order_acquire);
+        if (t == 0) {
+            // Probes grow long near the end, the table is full well before
+            if (count.load(std::memory_order_relaxed) >= capacity() / 10 * 9) {
+                std::cerr << "State table of " << capacity() << " states is full, give a larger --table-size"
+                          << std::endl;
+                exit(1);
+            }
+            if (tags[i].compare_exchange_strong(t, 1, std::memory_order_acq_rel)) {
+                memcpy(keys.get() + i * words, key, words * sizeof(*key));
+                tags[i].store(tag, std::memory_order_release);
+                count.fetch_add(1, std::memory_order_relaxed);
+                return {i, true};
+            }
+        }
+        // Key is being written by the thread which claimed the slot
+        while (t == 1) {
+            t = tags[i].load(std::memory_order_acquire);
+        }
+        if (t == tag && !memcmp(keys.get() + i * words, key, words * sizeof(*key))) {
+            return {i, false};
+        }
+    }
+}
+
+void
+SharedStateTable::set_color(uint32_t slot, unsigned thread, unsigned color) {
+    // Only this thread changes its bits, one xor turns the old color into the new one
+    uint64_t old = colors[slot].load(std::memory_order_relaxed) >> 2 * thread & 3;
+    colors[slot].fetch_xor((old ^ color) << 2 * thread, std::memory_order_acq_rel);
+}
+
+ParallelSearch::ParallelSearch(const kripke::Kripke &model, Tableau &tableau, unsigned threads, unsigned log2_slots):
+        threads(threads), products(), table(model.state_words() + 1, log2_slots), _stats(threads) {
+    for (uint32_t q = 0; q < tableau.size(); ++q) {
+        tableau.successors(q);
+    }
+    for (unsigned i = 0; i < threads; ++i) {
+        products.emplace_back(new Product(model, tableau));
+    }
+    vector<uint64_t> key(products[0]->key_words());
+    products[0]->initial_key(key.data());
+    initial = table.insert(key.data()).first;
+}
+
+bool
+ParallelSearch::run(Trace *trace) {
+    this->trace = trace;
+    vector<std::thread> workers;
+    for (unsigned i = 0; i < threads; ++i) {
+        workers.emplace_back(&ParallelSearch::worker, this, i);
+    }
+    for (auto &w: workers) {
+        w.join();
+    }
+    return found;
+}
+
+void
+ParallelSearch::worker(unsigned thread) {
+    auto start = std::chrono::steady_clock::now();
+    Product &product = *products[thread];
+    std::mt19937_64 rng(thread);
+    struct Frame {
+        uint32_t slot;
+        vector<uint32_t> succ;
+        size_t next;
+    };
+    vector<Frame> blue, red;
+    vector<uint32_t> pink;  // states of the current red search, the seed first
+    vector<uint64_t> keys;
+    uint64_t states = 0;
+    const auto push = [&](vector<Frame> &stack, uint32_t slot) {
+        stack.push_back({slot, {}, 0});
+        keys.clear();
+        product.successor_keys(table.key(slot), keys);
+        for (size_t i = 0; i < keys.size(); i += product.key_words()) {
+            stack.back().succ.push_back(table.insert(keys.data() + i).first);
+        }
+        // Threads spread over the graph by taking successors in different orders, the first one
+        // keeps the order of generation
+        if (thread) {
+            std::shuffle(stack.back().succ.begin(), stack.back().succ.end(), rng);
+        }
+    };
+    const auto accepting = [&](uint32_t slot) { return product.accepting_key(table.key(slot)); };
+    // Cycle through blue stack from state t up, closed by red stack if any. The first thread to
+    // find one writes the trace
+    const auto report = [&](uint32_t t) {
+        if (!found.exchange(true) && trace) {
+            size_t pos = 0;
+            while (blue[pos].slot != t) {
+                pos++;
+            }
+            for (size_t i = 0; i < blue.size(); ++i) {
+                (i < pos ? trace->prefix : trace->cycle).push_back(blue[i].slot);
+            }
+            for (size_t i = 1; i < red.size(); ++i) {
+                trace->cycle.push_back(red[i].slot);
+            }
+        }
+    };
+    const auto finish = [&]() {
+        _stats[thread].states = states;
+        _stats[thread].seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    push(blue, initial);
+    table.set_color(initial, thread, CYAN);
+    states++;
+    while (!blue.empty() && !found.load(std::memory_order_relaxed)) {
+        Frame &f = blue.back();
+        if (f.next < f.succ.size()) {
+            uint32_t s = f.slot, t = f.succ[f.next++];
+            unsigned color = table.color(t, thread);
+            if (color == CYAN && (accepting(s) || accepting(t))) {
+                report(t);
+                break;
+            }
+            if (color == WHITE && !table.red(t)) {
+                push(blue, t);
+                table.set_color(t, thread, CYAN);
+                states++;
+            }
+            continue;
+        }
+        if (accepting(f.slot) && !table.red(f.slot)) {
+            // Red search marks what it reaches pink, the seed stays cyan so a cycle back is seen
+            pink.assign(1, f.slot);
+            push(red, f.slot);
+            while (!red.empty() && !found.load(std::memory_order_relaxed)) {
+                Frame &r = red.back();
+                if (r.next < r.succ.size()) {
+                    uint32_t t = r.succ[r.next++];
+                    unsigned color = table.color(t, thread);
+                    if (color == CYAN) {
+                        report(t);
+                        break;
+                    }
+                    if (color != PINK && !table.red(t)) {
+                        table.set_color(t, thread, PINK);
+                        pink.push_back(t);
+                        push(red, t);
+                    }
+                    continue;
+                }
+                red.pop_back();
+            }
+            if (found.load(std::memory_order_relaxed)) {
+                break;
+            }
+            // Accepting states reached are seeds of other threads' red searches, their results
+            // are waited for before these states are red for all
+            for (size_t i = 1; i < pink.size(); ++i) {
+                while (accepting(pink[i]) && !table.red(pink[i]) && !found.load(std::memory_order_relaxed)) {
+                    std::this_thread::yield();
+                }
+            }
+            for (uint32_t s: pink) {
+                table.set_red(s);
+            }
+        }
+        table.set_color(blue.back().slot, thread, BLUE);
+        blue.pop_back();
+    }
+    finish();
+}
+
+} // namespace model::ltl
@@ -0,0 +1,93 @@
+/*
+ * Copyright 2024 Winking-maniac (http://github.com/Winking-maniac)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except
+ * in compliance with the License. You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed under the License
+ * is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+ * or implied. See the License for the specific language governing permissions and limitations under
+ * the License.
+ */
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "kripke.h"
+#include "ltl.h"
+#include "product.h"
+
+namespace model::ltl {
+
+// Visited states shared by all threads, without locks. Capacity is fixed: a slot is claimed by
+// compare and swap of its tag, the claiming thread writes the key and publishes the tag. Next to
+// the key every slot has a word of colors, 2 bits per thread and the global red bit
+class SharedStateTable final {
+public:
+    static constexpr unsigned max_threads = 31;
+    static constexpr uint64_t RED = 1ull << 63;
+
+    SharedStateTable(size_t words, unsigned log2_slots);
+
+    // Returns slot of the key, and whether it was inserted now. Exits when the table is full
+    std::pair<uint32_t, bool> insert(const uint64_t *key);
+    const uint64_t* key(uint32_t slot) const { return keys.get() + (size_t)slot * words; }
+    size_t size() const { return count.load(std::memory_order_relaxed); }
+    size_t capacity() const { return mask + 1; }
+
+    unsigned color(uint32_t slot, unsigned thread) const {
+        return colors[slot].load(std::memory_order_acquire) >> 2 * thread & 3;
+    }
+    void set_color(uint32_t slot, unsigned thread, unsigned color);
+    bool red(uint32_t slot) const { return colors[slot].load(std::memory_order_acquire) & RED; }
+    void set_red(uint32_t slot) { colors[slot].fetch_or(RED, std::memory_order_release); }
+
+private:
+    size_t words;
+    size_t mask;
+    std::atomic<size_t> count{0};
+    std::unique_ptr<std::atomic<uint32_t>[]> tags;  // 0 is empty, 1 is being written, else hash tag
+    std::unique_ptr<std::atomic<uint64_t>[]> colors;
+    std::unique_ptr<uint64_t[]> keys;
+};
+
+// Multi-core nested depth first search (CNDFS) of Evangelista, Laarman, Petrucci and van de Pol
+// over the product of a Kripke structure and the tableau of the negated formula. Every thread runs
+// its own blue search from the initial state in its own random order of successors, colors are per
+// thread, and red search results are shared: states of a finished red search become red for all.
+// Thread finding a cycle stops the others
+class ParallelSearch final {
+public:
+    struct WorkerStats {
+        uint64_t states;  // states this thread's blue search visited
+        double seconds;
+    };
+
+    // Tableau is expanded completely, threads only read it
+    ParallelSearch(const kripke::Kripke &model, Tableau &tableau, unsigned threads, unsigned log2_slots);
+
+    // Returns true and sets trace of slots, if not NULL, when an accepting cycle exists
+    bool run(Trace *trace);
+    kripke::Kripke::Values values(uint32_t slot) const { return products[0]->values_key(table.key(slot)); }
+    size_t size() const { return table.size(); }
+    const std::vector<WorkerStats>& stats() const { return _stats; }
+
+private:
+    void worker(unsigned thread);
+
+    unsigned threads;
+    // Products are per thread for their scratch space, their own tables stay empty
+    std::vector<std::unique_ptr<Product>> products;
+    SharedStateTable table;
+    uint32_t initial;
+    std::atomic<bool> found{false};
+    Trace *trace;
+    std::vector<WorkerStats> _stats;
+};
+
+} // namespace model::ltl
@@ -0,0 +1,242 @@
+/*
+ * Copyright 2024 Winking-maniac (http://github.com/Winking-maniac)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except
+ * in compliance with the License. You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed under the License
+ * is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+ * or implied. See the License for the specific language governing permissions and limitations under
+ * the License.
+ */
+
+#pragma once
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "fsm.h"
+#include "ltl.h"
+#include <boost/dynamic_bitset.hpp>
+
+namespace model::ltl {
+
+// Accepting run: prefix from an initial state, then cycle repeated forever. A step is a state and
+// the index of the edge taken from it, the cycle starts and ends in the same state
+struct Lasso {
+    struct Step {
+        uint32_t state;
+        size_t edge;
+    };
+    std::vector<Step> prefix, cycle;
+};
+
+// Generalized Buchi automata for the emptiness check. A graph has
+//   initial(): initial states
+//   degree(s), target(s, i): number of edges of s and the target of its i-th edge
+//   accepting(s): acceptance sets s belongs to, acc_sets() bits
+//   label(s, i): letters of the i-th edge of s as text
+// States are dense ids, successors may be computed when asked first
+
+// Tableau with lazy expansion: only what the check visits is ever built
+class TableauGraph final {
+public:
+    explicit TableauGraph(Tableau &tableau): tableau(tableau), _initial{tableau.initial()} {}
+
+    const std::vector<uint32_t>& initial() const { return _initial; }
+    size_t degree(uint32_t s) { return tableau.successors(s).size(); }
+    uint32_t target(uint32_t s, size_t i) { return tableau.successors(s)[i].target; }
+    const boost::dynamic_bitset<>& accepting(uint32_t s) const { return tableau.accepting(s); }
+    size_t acc_sets() const { return tableau.acc_sets(); }
+    std::string label(uint32_t s, size_t i);
+
+private:
+    Tableau &tableau;
+    std::vector<uint32_t> _initial;
+};
+
+class AutomatonGraph final {
+public:
+    explicit AutomatonGraph(const fsm::IndexedAutomaton &automaton);
+
+    const std::vector<uint32_t>& initial() const { return automaton.initial(); }
+    size_t degree(uint32_t s) const { return automaton.end(s) - automaton.begin(s); }
+    uint32_t target(uint32_t s, size_t i) const { return automaton.begin(s)[i].target; }
+    const boost::dynamic_bitset<>& accepting(uint32_t s) const { return acc[s]; }
+    size_t acc_sets() const { return automaton.final_sets().size(); }
+    std::string label(uint32_t s, size_t i) const { return automaton.guard_string(automaton.begin(s)[i].guard); }
+
+private:
+    const fsm::IndexedAutomaton &automaton;
+    std::vector<boost::dynamic_bitset<>> acc;  // final sets in order of their indices
+};
+
+inline std::string TableauGraph::label(uint32_t s, size_t i) {
+    const auto &label = tableau.label(tableau.successors(s)[i].label);
+    std::string text;
+    for (size_t j = 0; j < tableau.atoms().size(); ++j) {
+        if (label.pos[j] || label.neg[j]) {
+            text += (text.empty() ? "" : " && ") + std::string(label.neg[j] ? "!" : "") + tableau.atoms()[j];
+        }
+    }
+    return text.empty() ? "true" : text;
+}
+
+inline AutomatonGraph::AutomatonGraph(const fsm::IndexedAutomaton &automaton):
+        automaton(automaton), acc(automaton.size(), boost::dynamic_bitset<>(automaton.final_sets().size())) {
+    size_t k = 0;
+    for (const auto &entry: automaton.final_sets()) {
+        for (uint32_t s = 0; s < entry.second.size(); ++s) {
+            acc[s][k] = entry.second[s];
+        }
+        k++;
+    }
+}
+
+// Desc: cycle search of Couvreur: depth first search keeps a stack of roots of strongly connected
+// components not finished yet, each with the acceptance sets of its states. Edge back to a live
+// state merges roots above it into one component. Search stops as soon as a component has all sets,
+// it need not be finished, and the graph beyond it is never asked for
+// Returns true and sets lasso, if not NULL, for a nonempty language
+template <class Graph>
+bool find_accepting_lasso(Graph &graph, Lasso *lasso);
+
+namespace detail {
+
+constexpr uint32_t DEAD = std::numeric_limits<uint32_t>::max();
+
+// Desc: breadth first search for a path of at least one edge from `from` through states of the
+// component, numbered at least `root` and live, to a state satisfying goal
+template <class Graph, class Goal>
+std::vector<Lasso::Step>
+component_path(Graph &graph, const std::vector<uint32_t> &number, uint32_t root, uint32_t from, Goal goal) {
+    std::unordered_map<uint32_t, Lasso::Step> parent;
+    std::vector<uint32_t> queue{from};
+    for (size_t head = 0; head < queue.size(); ++head) {
+        uint32_t s = queue[head];
+        for (size_t i = 0; i < graph.degree(s); ++i) {
+            uint32_t t = graph.target(s, i);
+            if (t >= number.size() || number[t] < root || number[t] == DEAD || parent.count(t)) {
+                continue;
+            }
+            parent.emplace(t, Lasso::Step{s, i});
+            if (goal(t)) {
+                std::vector<Lasso::Step> path;
+                for (uint32_t u = t; path.empty() || u != from; u = path.back().state) {
+                    path.push_back(parent.at(u));
+                }
+                return {path.rbegin(), path.rend()};
+            }
+            queue.push_back(t);
+        }
+    }
+    return {};
+}
+
+} // namespace detail
+
+template <class Graph>
+bool find_accepting_lasso(Graph &graph, Lasso *lasso) {
+    using detail::DEAD;
+    struct Root {
+        uint32_t number;
+        boost::dynamic_bitset<> acc;
+    };
+    struct Frame {
+        uint32_t state;
+        size_t next;  // next edge to follow
+    };
+    std::vector<uint32_t> number;  // order of visit from 1, 0 is unvisited, DEAD in finished components
+    std::vector<Root> roots;
+    std::vector<uint32_t> live;    // visited states of unfinished components
+    std::vector<Frame> dfs;
+    uint32_t count = 0;
+    const auto visit = [&](uint32_t s) {
+        if (number.size() <= s) {
+            number.resize(s + 1);
+        }
+        number[s] = ++count;
+        roots.push_back({count, graph.accepting(s)});
+        live.push_back(s);
+        dfs.push_back({s, 0});
+    };
+    for (uint32_t init: graph.initial()) {
+        if (init < number.size() && number[init]) {
+            continue;
+        }
+        visit(init);
+        while (!dfs.empty()) {
+            uint32_t s = dfs.back().state;
+            if (dfs.back().next < graph.degree(s)) {
+                uint32_t t = graph.target(s, dfs.back().next++);
+                if (t >= number.size() || number[t] == 0) {
+                    visit(t);
+                    continue;
+                }
+                if (number[t] == DEAD) {
+                    continue;
+                }
+                // t is live, so it reaches s: cycle through all components from t's one up
+                boost::dynamic_bitset<> acc(graph.acc_sets());
+                while (roots.back().number > number[t]) {
+                    acc |= roots.back().acc;
+                    roots.pop_back();
+                }
+                roots.back().acc |= acc;
+                if (roots.back().acc.count() < graph.acc_sets()) {
+                    continue;
+                }
+                if (!lasso) {
+                    return true;
+                }
+                // Component root is on the depth first stack, prefix is the path to it. Cycle goes
+                // through the component to each missing set, then back to the root
+                uint32_t root = roots.back().number;
+                lasso->prefix.clear();
+                lasso->cycle.clear();
+                size_t i = 0;
+                for (; number[dfs[i].state] != root; ++i) {
+                    lasso->prefix.push_back({dfs[i].state, dfs[i].next - 1});
+                }
+                uint32_t start = dfs[i].state, at = start;
+                boost::dynamic_bitset<> seen = graph.accepting(start);
+                for (size_t k = 0; k < graph.acc_sets(); ++k) {
+                    if (seen[k]) {
+                        continue;
+                    }
+                    auto path = detail::component_path(graph, number, root, at,
+                            [&](uint32_t u) { return (bool)graph.accepting(u)[k]; });
+                    for (const auto &step: path) {
+                        lasso->cycle.push_back(step);
+                        at = graph.target(step.state, step.edge);
+                        seen |= graph.accepting(at);
+                    }
+                }
+                if (at != start || lasso->cycle.empty()) {
+                    auto path = detail::component_path(graph, number, root, at,
+                            [&](uint32_t u) { return u == start; });
+                    lasso->cycle.insert(lasso->cycle.end(), path.begin(), path.end());
+                }
+                return true;
+            }
+            // All edges followed: s closes its component if it is the root
+            if (roots.back().number == number[s]) {
+                roots.pop_back();
+                uint32_t u;
+                do {
+                    u = live.back();
+                    live.pop_back();
+                    number[u] = DEAD;
+                } while (u != s);
+            }
+            dfs.pop_back();
+        }
+    }
+    return false;
+}
+
+} // namespace model::ltl
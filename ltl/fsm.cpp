@@ -1,3 +1,6 @@
+#include <algorithm>
+#include <string>
+#include <unordered_map>
 #include <iostream>
 #include <map>
 #include <set>
@@ -58,4 +61,162 @@ std::ostream& operator <<(std::ostream &out, const Automaton &automaton) {
   return out;
 }
 
-}
\ No newline at end of file
+void IndexedAutomaton::simplify(Guard &guard) {
+  const auto implies = [](const Cube &a, const Cube &b) {
+    return (a.pos & b.pos) == b.pos && (a.neg & b.neg) == b.neg;
+  };
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    std::sort(guard.begin(), guard.end());
+    guard.erase(std::unique(guard.begin(), guard.end()), guard.end());
+    // c && x || c && !x is c
+    for (size_t i = 0; i < guard.size(); ++i) {
+      for (size_t j = i + 1; j < guard.size(); ++j) {
+        Letter diff = guard[i].pos ^ guard[j].pos;
+        if (diff && (diff & (diff - 1)) == 0 && (guard[i].neg ^ guard[j].neg) == diff
+            && (guard[i].pos | guard[i].neg) == (guard[j].pos | guard[j].neg)) {
+          guard[i].pos &= ~diff;
+          guard[i].neg &= ~diff;
+          guard[j] = guard.back();
+          guard.pop_back();
+          changed = true;
+          break;
+        }
+      }
+    }
+    // Merges may have made cubes equal, each would be implied by the other
+    std::sort(guard.begin(), guard.end());
+    guard.erase(std::unique(guard.begin(), guard.end()), guard.end());
+    // Cube with more literals than another one adds no letters
+    size_t kept = 0;
+    for (size_t i = 0; i < guard.size(); ++i) {
+      bool implied = false;
+      for (size_t j = 0; j < guard.size() && !implied; ++j) {
+        implied = j != i && implies(guard[i], guard[j]);
+      }
+      if (implied) {
+        changed = true;
+      } else {
+        guard[kept++] = guard[i];
+      }
+    }
+    guard.resize(kept);
+  }
+}
+
+std::string IndexedAutomaton::guard_string(uint32_t guard) const {
+  // Atoms of a cube are printed sorted by name
+  std::vector<uint32_t> order(_atoms.size());
+  for (uint32_t i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+  std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+    return _atoms[a] < _atoms[b];
+  });
+  const Guard &cubes = _guards[guard];
+  std::string text;
+  for (size_t i = 0; i < cubes.size(); ++i) {
+    text += i ? " || " : "";
+    bool conjunction = false;
+    for (uint32_t atom: order) {
+      if ((cubes[i].pos | cubes[i].neg) >> atom & 1) {
+        text += conjunction ? " && " : "";
+        text += cubes[i].neg >> atom & 1 ? "!" : "";
+        text += _atoms[atom];
+        conjunction = true;
+      }
+    }
+    text += conjunction ? "" : "true";
+  }
+  return cubes.empty() ? "false" : text;
+}
+
+std::ostream& operator <<(std::ostream &out, const IndexedAutomaton &automaton) {
+  const auto name = [](uint32_t state) { return "s" + std::to_string(state); };
+
+  out << "S0 = {";
+  bool separator = false;
+  for (uint32_t state: automaton._initial_states) {
+    out << (separator ? ", " : "") << name(state);
+    separator = true;
+  }
+  out << "}" << std::endl;
+
+  for (const auto &entry: automaton._final_states) {
+    out << "F" << entry.first << " = {";
+    separator = false;
+    for (uint32_t state = 0; state < entry.second.size(); ++state) {
+      if (entry.second[state]) {
+        out << (separator ? ", " : "") << name(state);
+        separator = true;
+      }
+    }
+    out << "}" << std::endl;
+  }
+
+  // Guards are few and shared by many transitions, each is formatted once
+  std::vector<std::string> guards(automaton._guards.size());
+  for (size_t g = 0; g < guards.size(); ++g) {
+    guards[g] = automaton.guard_string(g);
+  }
+
+  out << "T = {" << std::endl;
+  separator = false;
+  for (uint32_t state = 0; state < automaton._size; ++state) {
+    for (auto e = automaton.begin(state); e != automaton.end(state); ++e) {
+      out << (separator ? "\n" : "") << "  " << name(state) << " --[" << guards[e->guard] << "]--> " << name(e->target);
+      separator = true;
+    }
+  }
+  out << std::endl << "}";
+
+  return out;
+}
+
+IndexedAutomaton degeneralize(const IndexedAutomaton &automaton) {
+  std::vector<unsigned> sets;
+  for (const auto &entry: automaton.final_sets()) {
+    sets.push_back(entry.first);
+  }
+  const uint64_t k = sets.empty() ? 1 : sets.size();
+  const auto waits = [&](uint32_t state, uint64_t counter) {
+    return sets.empty() || automaton.is_final(state, sets[counter]);
+  };
+
+  IndexedAutomaton result;
+  for (const auto &atom: automaton.atoms()) {
+    result.add_atom(atom);
+  }
+  result.add_final_set(0);
+  // Pair (state, counter) is key state * k + counter, ids are given in breadth first order, so
+  // transitions are added in order of their sources
+  std::unordered_map<uint64_t, uint32_t> ids;
+  std::vector<uint64_t> pairs;
+  const auto visit = [&](uint64_t key) {
+    auto found = ids.emplace(key, pairs.size());
+    if (found.second) {
+      pairs.push_back(key);
+      result.add_state();
+    }
+    return found.first->second;
+  };
+  for (uint32_t state: automaton.initial()) {
+    result.set_initial(visit(state * k));
+  }
+  for (uint32_t id = 0; id < pairs.size(); ++id) {
+    uint32_t state = pairs[id] / k;
+    uint64_t counter = pairs[id] % k;
+    bool done = waits(state, counter);
+    if (done && counter == k - 1) {
+      result.set_final(id, 0);
+    }
+    uint64_t next = done ? (counter + 1) % k : counter;
+    for (auto e = automaton.begin(state); e != automaton.end(state); ++e) {
+      result.add_trans(id, automaton.guard(e->guard), visit(e->target * k + next));
+    }
+  }
+  return result;
+}
+
+}
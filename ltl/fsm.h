@@ -13,9 +13,13 @@
  */
 
 #pragma once
+#include <cassert>
+#include <cstdint>
 #include <iostream>
 #include <map>
 #include <set>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace model::fsm {
@@ -64,6 +68,8 @@ public:
   void add_state(const std::string &state_label);
   void set_initial(const std::string &state_label);
   void set_final(const std::string &state_label, unsigned final_set_index);
+  // Acceptance set without states yet; an empty set accepts no run
+  void add_final_set(unsigned final_set_index);
 
   void add_trans(
     const std::string &source,
@@ -91,6 +97,10 @@ inline void Automaton::set_final(const std::string &state_label, unsigned final_
   _final_states[final_set_index].insert(state_label);
 }
 
+inline void Automaton::add_final_set(unsigned final_set_index) {
+  _final_states[final_set_index];
+}
+
 inline void Automaton::add_trans(
   const std::string &source,
   const std::set<std::string> &symbol,
@@ -103,4 +113,162 @@ inline void Automaton::add_trans(
   _transitions[source].push_back(trans);
 }
 
-} // namespace model::fsm
\ No newline at end of file
+// Automaton over dense state ids 0 .. size() - 1. Atoms are interned, a letter is the bitmask of
+// atom ids true in it. A transition is guarded by a formula over atoms in disjunctive normal form
+// and reads every letter satisfying it, equal guards are stored once. Transitions are kept in one
+// array grouped by source (CSR), so they are added in order of their sources. Names exist at print
+// time only: state i is "s<i>"
+class IndexedAutomaton final {
+  friend std::ostream& operator <<(std::ostream &out, const IndexedAutomaton &automaton);
+
+public:
+  using Letter = uint64_t;
+  static constexpr size_t max_atoms = 64;
+
+  // Conjunction of atoms in pos and negated atoms in neg
+  struct Cube {
+    Letter pos, neg;
+
+    bool operator <(const Cube &rhs) const {
+      return pos < rhs.pos || (pos == rhs.pos && neg < rhs.neg);
+    }
+    bool operator ==(const Cube &rhs) const { return pos == rhs.pos && neg == rhs.neg; }
+  };
+  // Disjunction of cubes, empty one is false
+  using Guard = std::vector<Cube>;
+
+  struct Edge {
+    uint32_t target;
+    uint32_t guard;  // index of the guard, see guard()
+  };
+
+  IndexedAutomaton() {}
+
+  // Returns id of the atom, the existing one for a known name
+  uint32_t add_atom(const std::string &name);
+  uint32_t add_state();
+  void set_initial(uint32_t state);
+  void set_final(uint32_t state, unsigned final_set_index);
+  // Acceptance set without states yet; an empty set accepts no run
+  void add_final_set(unsigned final_set_index);
+  // Source must not be less than the source of the previous transition. One transition per source
+  // and target is enough, the guard covers all letters between them
+  void add_trans(uint32_t source, Guard guard, uint32_t target);
+  // Transition reading exactly the letter
+  void add_trans(uint32_t source, Letter letter, uint32_t target);
+
+  size_t size() const { return _size; }
+  size_t transitions() const { return _edges.size(); }
+  const std::vector<std::string>& atoms() const { return _atoms; }
+  const std::vector<uint32_t>& initial() const { return _initial_states; }
+  const std::map<unsigned, std::vector<bool>>& final_sets() const { return _final_states; }
+  bool is_final(uint32_t state, unsigned final_set_index) const;
+  const Guard& guard(uint32_t guard) const { return _guards[guard]; }
+  // Guard as "p && !q || r", atoms of a cube sorted by name
+  std::string guard_string(uint32_t guard) const;
+  static bool satisfies(const Guard &guard, Letter letter);
+  // Desc: drops cubes implied by others and merges cubes differing in one literal only
+  static void simplify(Guard &guard);
+
+  const Edge* begin(uint32_t state) const {
+    return _edges.data() + (state < _start.size() ? _start[state] : _edges.size());
+  }
+  const Edge* end(uint32_t state) const {
+    return _edges.data() + (state + 1 < _start.size() ? _start[state + 1] : _edges.size());
+  }
+
+private:
+  uint32_t _size = 0;
+  std::vector<std::string> _atoms;
+  std::unordered_map<std::string, uint32_t> _atom_ids;
+  std::vector<uint32_t> _initial_states;
+  std::map<unsigned, std::vector<bool>> _final_states;  // indexed by state
+  // Edges of state s start at _start[s]; states after the last source have none yet
+  std::vector<uint32_t> _start;
+  std::vector<Edge> _edges;
+  std::vector<Guard> _guards;
+  std::map<Guard, uint32_t> _guard_ids;
+  std::unordered_map<Letter, uint32_t> _letter_guards;
+};
+
+inline uint32_t IndexedAutomaton::add_atom(const std::string &name) {
+  auto found = _atom_ids.find(name);
+  if (found != _atom_ids.end()) {
+    return found->second;
+  }
+  assert(_atoms.size() < max_atoms);
+  _atoms.push_back(name);
+  _atom_ids.emplace(name, _atoms.size() - 1);
+  return _atoms.size() - 1;
+}
+
+inline uint32_t IndexedAutomaton::add_state() {
+  return _size++;
+}
+
+inline void IndexedAutomaton::set_initial(uint32_t state) {
+  _initial_states.push_back(state);
+}
+
+inline void IndexedAutomaton::set_final(uint32_t state, unsigned final_set_index) {
+  auto &states = _final_states[final_set_index];
+  if (states.size() < _size) {
+    states.resize(_size);
+  }
+  states[state] = true;
+}
+
+inline bool IndexedAutomaton::is_final(uint32_t state, unsigned final_set_index) const {
+  auto found = _final_states.find(final_set_index);
+  return found != _final_states.end() && state < found->second.size() && found->second[state];
+}
+
+inline void IndexedAutomaton::add_final_set(unsigned final_set_index) {
+  _final_states[final_set_index];
+}
+
+inline void IndexedAutomaton::add_trans(uint32_t source, Guard guard, uint32_t target) {
+  assert(source < _size && target < _size && source + 1 >= _start.size());
+  while (_start.size() <= source) {
+    _start.push_back(_edges.size());
+  }
+  simplify(guard);
+  auto found = _guard_ids.emplace(guard, _guards.size());
+  if (found.second) {
+    _guards.push_back(std::move(guard));
+  }
+  _edges.push_back({target, found.first->second});
+}
+
+inline void IndexedAutomaton::add_trans(uint32_t source, Letter letter, uint32_t target) {
+  // Single full cube is simple already, letters skip the guard lookup
+  auto found = _letter_guards.find(letter);
+  if (found == _letter_guards.end()) {
+    Letter all = _atoms.size() == max_atoms ? ~Letter(0) : (Letter(1) << _atoms.size()) - 1;
+    add_trans(source, Guard{{letter, all & ~letter}}, target);
+    _letter_guards.emplace(letter, _edges.back().guard);
+    return;
+  }
+  assert(source < _size && target < _size && source + 1 >= _start.size());
+  while (_start.size() <= source) {
+    _start.push_back(_edges.size());
+  }
+  _edges.push_back({target, found->second});
+}
+
+inline bool IndexedAutomaton::satisfies(const Guard &guard, Letter letter) {
+  for (const auto &cube: guard) {
+    if ((letter & cube.pos) == cube.pos && (letter & cube.neg) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Desc: counter construction, states are pairs of a state and the acceptance set it waits for. The
+// counter moves on in states of that set, so the single set of the result, states of the last set
+// while waiting for it, is visited infinitely often iff all sets are. Only reachable pairs are built.
+// Without acceptance sets every state is accepting
+IndexedAutomaton degeneralize(const IndexedAutomaton &automaton);
+
+} // namespace model::fsm
@@ -0,0 +1,635 @@
+/*
+ * Copyright 2024 Winking-maniac (http://github.com/Winking-maniac)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except
+ * in compliance with the License. You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed under the License
+ * is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+ * or implied. See the License for the specific language governing permissions and limitations under
+ * the License.
+ */
+
+#include "kripke.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+using std::cerr;
+using std::endl;
+using std::string;
+using std::vector;
+
+namespace model::kripke {
+
+namespace {
+
+const char BINARY_MAGIC[] = "KRIPKEB1";
+
+// Tokens of one line of the text form, with the position for error messages
+class Lexer final {
+public:
+    Lexer(const string &path, size_t line_no, const string &line): path(path), line_no(line_no) {
+        for (size_t i = 0; i < line.size() && line[i] != '#';) {
+            if (isspace((unsigned char)line[i])) {
+                i++;
+            } else if (isalpha((unsigned char)line[i]) || line[i] == '_') {
+                size_t j = i;
+                while (j < line.size() && (isalnum((unsigned char)line[j]) || line[j] == '_')) {
+                    j++;
+                }
+                tokens.push_back(line.substr(i, j - i));
+                i = j;
+            } else if (isdigit((unsigned char)line[i])) {
+                size_t j = i;
+                while (j < line.size() && isdigit((unsigned char)line[j])) {
+                    j++;
+                }
+                tokens.push_back(line.substr(i, j - i));
+                i = j;
+            } else {
+                static const char *ops[] = {"->", "==", "!=", "<=", ">=", "&&", "..", "<", ">", "=", "+", "-", ","};
+                size_t len = 0;
+                for (const char *op: ops) {
+                    if (line.compare(i, strlen(op), op) == 0) {
+                        len = strlen(op);
+                        break;
+                    }
+                }
+                if (len == 0) {
+                    fail(string("unexpected '") + line[i] + "'");
+                }
+                tokens.push_back(line.substr(i, len));
+                i += len;
+            }
+        }
+    }
+
+    bool done() const { return pos == tokens.size(); }
+    const string& peek() const {
+        static const string end;
+        return done() ? end : tokens[pos];
+    }
+    string next(const char *what) {
+        if (done()) {
+            fail(string("expected ") + what);
+        }
+        return tokens[pos++];
+    }
+    void expect(const string &token) {
+        if (next(token.c_str()) != token) {
+            fail("expected '" + token + "' before '" + tokens[pos - 1] + "'");
+        }
+    }
+    bool accept(const string &token) {
+        if (peek() == token) {
+            pos++;
+            return true;
+        }
+        return false;
+    }
+    int32_t number() {
+        bool neg = accept("-");
+        string t = next("number");
+        if (!isdigit((unsigned char)t[0])) {
+            fail("expected number before '" + t + "'");
+        }
+        long v = strtol(t.c_str(), nullptr, 10);
+        return neg ? -v : v;
+    }
+    [[noreturn]] void fail(const string &message) const {
+        cerr << path << ":" << line_no << ": " << message << endl;
+        exit(1);
+    }
+
+private:
+    const string &path;
+    size_t line_no;
+    vector<string> tokens;
+    size_t pos = 0;
+};
+
+bool is_number(const string &token) {
+    return !token.empty() && (isdigit((unsigned char)token[0]) || token == "-");
+}
+
+void put32(std::ostream &out, uint32_t x) {
+    out.write(reinterpret_cast<const char *>(&x), sizeof(x));
+}
+
+void put_string(std::ostream &out, const string &s) {
+    put32(out, s.size());
+    out.write(s.data(), s.size());
+}
+
+void put_conds(std::ostream &out, const vector<Kripke::Cond> &conds) {
+    put32(out, conds.size());
+    for (const auto &c: conds) {
+        put32(out, c.var);
+        put32(out, c.op);
+        put32(out, c.rhs_var);
+        put32(out, c.rhs);
+    }
+}
+
+// Sorted variable lists
+bool disjoint(const vector<uint32_t> &a, const vector<uint32_t> &b) {
+    for (size_t i = 0, j = 0; i < a.size() && j < b.size();) {
+        if (a[i] == b[j]) {
+            return false;
+        }
+        a[i] < b[j] ? ++i : ++j;
+    }
+    return true;
+}
+
+void add_var(vector<uint32_t> &vars, uint32_t var) {
+    auto it = std::lower_bound(vars.begin(), vars.end(), var);
+    if (it == vars.end() || *it != var) {
+        vars.insert(it, var);
+    }
+}
+
+class Reader final {
+public:
+    Reader(const string &path, std::istream &in): path(path), in(in) {}
+
+    uint32_t get32() {
+        uint32_t x;
+        if (!in.read(reinterpret_cast<char *>(&x), sizeof(x))) {
+            fail();
+        }
+        return x;
+    }
+    // Count of items, each at least 4 bytes; bounds allocation by a corrupt count
+    uint32_t count() {
+        uint32_t n = get32();
+        if (n > (1u << 28)) {
+            fail();
+        }
+        return n;
+    }
+    string get_string() {
+        string s(count(), '\0');
+        if (!in.read(&s[0], s.size())) {
+            fail();
+        }
+        return s;
+    }
+    vector<Kripke::Cond> get_conds(size_t n_vars) {
+        vector<Kripke::Cond> conds(count());
+        for (auto &c: conds) {
+            c.var = index(n_vars);
+            c.op = (Kripke::Op)get32();
+            c.rhs_var = get32();
+            c.rhs = get32();
+            if (c.op > Kripke::GE || (c.rhs_var && (uint32_t)c.rhs >= n_vars)) {
+                fail();
+            }
+        }
+        return conds;
+    }
+    uint32_t index(size_t size) {
+        uint32_t i = get32();
+        if (i >= size) {
+            fail();
+        }
+        return i;
+    }
+    [[noreturn]] void fail() const {
+        cerr << path << ": truncated or corrupt binary model" << endl;
+        exit(1);
+    }
+
+private:
+    const string &path;
+    std::istream &in;
+};
+
+} // namespace
+
+Kripke
+Kripke::load(const string &path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        cerr << path << ": can not open" << endl;
+        exit(1);
+    }
+    Kripke k;
+    char magic[sizeof(BINARY_MAGIC) - 1] = {};
+    in.read(magic, sizeof(magic));
+    if (in && !memcmp(magic, BINARY_MAGIC, sizeof(magic))) {
+        Reader r(path, in);
+        k._vars.resize(r.count());
+        for (auto &v: k._vars) {
+            v.name = r.get_string();
+            v.min = r.get32();
+            v.max = r.get32();
+            v.init = r.get32();
+            if (v.min > v.max || v.init < v.min || v.init > v.max) {
+                r.fail();
+            }
+        }
+        k._atoms.resize(r.count());
+        for (auto &a: k._atoms) {
+            a.name = r.get_string();
+            a.conds = r.get_conds(k._vars.size());
+        }
+        k._processes.resize(r.count());
+        for (auto &p: k._processes) {
+            p = r.get_string();
+        }
+        k._transitions.resize(r.count());
+        for (auto &t: k._transitions) {
+            t.process = r.index(k._processes.size());
+            t.guard = r.get_conds(k._vars.size());
+            t.assigns.resize(r.count());
+            for (auto &a: t.assigns) {
+                a.var = r.index(k._vars.size());
+                a.src_var = r.get32();
+                a.src = a.src_var ? r.index(k._vars.size()) : r.get32();
+                a.add = r.get32();
+            }
+        }
+        k.layout();
+        k.annotate();
+        return k;
+    }
+
+    in.clear();
+    in.seekg(0);
+    std::map<string, uint32_t> var_ids, atom_ids;
+    string line;
+    size_t line_no = 0;
+    const auto var = [&](Lexer &lex) {
+        string name = lex.next("variable");
+        auto found = var_ids.find(name);
+        if (found == var_ids.end()) {
+            lex.fail("unknown variable '" + name + "'");
+        }
+        return found->second;
+    };
+    const auto conds = [&](Lexer &lex, const string &until) {
+        vector<Cond> res;
+        if (lex.accept("true")) {
+            return res;
+        }
+        do {
+            Cond c;
+            c.var = var(lex);
+            static const std::map<string, Op> ops = {
+                {"==", EQ}, {"!=", NE}, {"<", LT}, {"<=", LE}, {">", GT}, {">=", GE}};
+            string op = lex.next("comparison");
+            auto found = ops.find(op);
+            if (found == ops.end()) {
+                lex.fail("expected comparison before '" + op + "'");
+            }
+            c.op = found->second;
+            c.rhs_var = !is_number(lex.peek());
+            c.rhs = c.rhs_var ? var(lex) : lex.number();
+            res.push_back(c);
+        } while (lex.accept("&&"));
+        if (lex.peek() != until) {
+            lex.fail(until.empty() ? "unexpected '" + lex.peek() + "'" : "expected '" + until + "'");
+        }
+        return res;
+    };
+    while (std::getline(in, line)) {
+        Lexer lex(path, ++line_no, line);
+        if (lex.done()) {
+            continue;
+        }
+        string keyword = lex.next("keyword");
+        if (keyword == "var") {
+            Var v;
+            v.name = lex.next("variable name");
+            if (!var_ids.emplace(v.name, k._vars.size()).second) {
+                lex.fail("variable '" + v.name + "' is defined twice");
+            }
+            v.min = lex.number();
+            lex.expect("..");
+            v.max = lex.number();
+            v.init = lex.accept("=") ? lex.number() : v.min;
+            if (v.min > v.max || v.init < v.min || v.init > v.max) {
+                lex.fail("bad bounds or initial value of '" + v.name + "'");
+            }
+            k._vars.push_back(v);
+        } else if (keyword == "atom") {
+            Atom a;
+            a.name = lex.next("atom name");
+            if (!atom_ids.emplace(a.name, k._atoms.size()).second) {
+                lex.fail("atom '" + a.name + "' is defined twice");
+            }
+            a.conds = conds(lex, "");
+            k._atoms.push_back(a);
+        } else if (keyword == "process") {
+            k._processes.push_back(lex.next("process name"));
+        } else if (keyword == "trans") {
+            if (k._processes.empty()) {
+                k._processes.push_back("main");
+            }
+            Trans t;
+            t.process = k._processes.size() - 1;
+            t.guard = conds(lex, "->");
+            lex.expect("->");
+            do {
+                Assign a;
+                a.var = var(lex);
+                lex.expect("=");
+                a.src_var = !is_number(lex.peek());
+                if (a.src_var) {
+                    a.src = var(lex);
+                    a.add = lex.accept("+") ? lex.number() : lex.accept("-") ? -lex.number() : 0;
+                } else {
+                    a.src = 0;
+                    a.add = lex.number();
+                }
+                t.assigns.push_back(a);
+            } while (lex.accept(","));
+            k._transitions.push_back(t);
+        } else {
+            lex.fail("unknown keyword '" + keyword + "'");
+        }
+        if (!lex.done()) {
+            lex.fail("unexpected '" + lex.peek() + "'");
+        }
+    }
+    k.layout();
+    k.annotate();
+    return k;
+}
+
+void
+Kripke::save_binary(const string &path) const {
+    std::ofstream out(path, std::ios::binary);
+    out.write(BINARY_MAGIC, sizeof(BINARY_MAGIC) - 1);
+    put32(out, _vars.size());
+    for (const auto &v: _vars) {
+        put_string(out, v.name);
+        put32(out, v.min);
+        put32(out, v.max);
+        put32(out, v.init);
+    }
+    put32(out, _atoms.size());
+    for (const auto &a: _atoms) {
+        put_string(out, a.name);
+        put_conds(out, a.conds);
+    }
+    put32(out, _processes.size());
+    for (const auto &p: _processes) {
+        put_string(out, p);
+    }
+    put32(out, _transitions.size());
+    for (const auto &t: _transitions) {
+        put32(out, t.process);
+        put_conds(out, t.guard);
+        put32(out, t.assigns.size());
+        for (const auto &a: t.assigns) {
+            put32(out, a.var);
+            put32(out, a.src_var);
+            put32(out, a.src);
+            put32(out, a.add);
+        }
+    }
+    if (!out.flush()) {
+        cerr << path << ": writing failed" << endl;
+        exit(1);
+    }
+}
+
+void
+Kripke::layout() {
+    _bits = 0;
+    for (auto &v: _vars) {
+        uint64_t range = (uint64_t)((int64_t)v.max - v.min);
+        v.bits = 0;
+        while (v.bits < 32 && range >> v.bits) {
+            v.bits++;
+        }
+        // Variable does not straddle words, unpacking reads one word per variable
+        if (_bits / 64 != (_bits + v.bits) / 64 && (_bits + v.bits) % 64) {
+            _bits = (_bits + 63) / 64 * 64;
+        }
+        v.offset = _bits;
+        _bits += v.bits;
+    }
+}
+
+void
+Kripke::annotate() {
+    by_process.assign(_processes.size(), {});
+    for (uint32_t i = 0; i < _transitions.size(); ++i) {
+        Trans &t = _transitions[i];
+        by_process[t.process].push_back(i);
+        t.reads.clear();
+        t.writes.clear();
+        for (const auto &c: t.guard) {
+            add_var(t.reads, c.var);
+            if (c.rhs_var) {
+                add_var(t.reads, c.rhs);
+            }
+        }
+        for (const auto &a: t.assigns) {
+            add_var(t.writes, a.var);
+            if (a.src_var) {
+                add_var(t.reads, a.src);
+            }
+        }
+    }
+    // Variables written and used by each process
+    vector<vector<uint32_t>> written(_processes.size()), used(_processes.size());
+    for (const auto &t: _transitions) {
+        for (uint32_t v: t.writes) {
+            add_var(written[t.process], v);
+            add_var(used[t.process], v);
+        }
+        for (uint32_t v: t.reads) {
+            add_var(used[t.process], v);
+        }
+    }
+    for (auto &t: _transitions) {
+        t.local = true;
+        t.local_guard.assign(t.guard.size(), true);
+        for (uint32_t p = 0; p < _processes.size(); ++p) {
+            if (p == t.process) {
+                continue;
+            }
+            t.local = t.local && disjoint(t.reads, written[p]) && disjoint(t.writes, used[p]);
+            for (size_t i = 0; i < t.guard.size(); ++i) {
+                const Cond &c = t.guard[i];
+                bool foreign = std::binary_search(written[p].begin(), written[p].end(), c.var) ||
+                               (c.rhs_var && std::binary_search(written[p].begin(), written[p].end(), c.rhs));
+                t.local_guard[i] = t.local_guard[i] && !foreign;
+            }
+        }
+    }
+}
+
+bool
+Kripke::independent(const Trans &a, const Trans &b) {
+    return disjoint(a.writes, b.reads) && disjoint(a.writes, b.writes) && disjoint(b.writes, a.reads);
+}
+
+int32_t
+Kripke::atom(const string &name) const {
+    for (size_t i = 0; i < _atoms.size(); ++i) {
+        if (_atoms[i].name == name) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+Kripke::Values
+Kripke::initial() const {
+    Values values(_vars.size());
+    for (size_t i = 0; i < _vars.size(); ++i) {
+        values[i] = _vars[i].init;
+    }
+    return values;
+}
+
+bool
+Kripke::holds(const Cond &c, const Values &values) const {
+    int32_t l = values[c.var], r = c.rhs_var ? values[c.rhs] : c.rhs;
+    switch (c.op) {
+        case EQ: return l == r;
+        case NE: return l != r;
+        case LT: return l < r;
+        case LE: return l <= r;
+        case GT: return l > r;
+        case GE: return l >= r;
+    }
+    return false;
+}
+
+bool
+Kripke::holds(const vector<Cond> &conds, const Values &values) const {
+    for (const auto &c: conds) {
+        if (!holds(c, values)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+Kripke::Values
+Kripke::apply(const Trans &trans, const Values &values) const {
+    Values res = values;
+    for (const auto &a: trans.assigns) {
+        int64_t v = (a.src_var ? values[a.src] : 0) + (int64_t)a.add;
+        const Var &var = _vars[a.var];
+        if (v < var.min || v > var.max) {
+            cerr << "Assignment of " << v << " to " << var.name << " in process " << _processes[trans.process]
+                 << " leaves its bounds, state " << show(values) << endl;
+            exit(1);
+        }
+        res[a.var] = v;
+    }
+    return res;
+}
+
+void
+Kripke::successors(const Values &values, vector<Values> &out) const {
+    out.clear();
+    for (const auto &t: _transitions) {
+        if (enabled(t, values)) {
+            out.push_back(apply(t, values));
+        }
+    }
+    if (out.empty()) {
+        out.push_back(values);
+    }
+}
+
+bool
+Kripke::ample(const Values &values, const vector<bool> &visible, vector<Values> &out) const {
+    vector<bool> enabled_now(_transitions.size());
+    size_t total = 0;
+    for (size_t i = 0; i < _transitions.size(); ++i) {
+        enabled_now[i] = enabled(_transitions[i], values);
+        total += enabled_now[i];
+    }
+    for (const auto &trans: by_process) {
+        size_t count = 0;
+        bool ok = true;
+        for (uint32_t i: trans) {
+            const Trans &t = _transitions[i];
+            if (enabled_now[i]) {
+                count++;
+                ok = ok && t.local && std::none_of(t.writes.begin(), t.writes.end(),
+                                                   [&](uint32_t v) { return visible[v]; });
+            }
+        }
+        if (!ok || !count || count == total) {
+            continue;
+        }
+        // Disabled transition waits for the process to move while a condition of its guard on
+        // variables only the process writes is false. If one does not, another process may enable
+        // it, it runs first and enables the others, so none of them may interfere
+        bool waiting = true;
+        for (uint32_t i: trans) {
+            const Trans &t = _transitions[i];
+            bool blocked = false;
+            for (size_t k = 0; k < t.guard.size(); ++k) {
+                blocked = blocked || (t.local_guard[k] && !holds(t.guard[k], values));
+            }
+            waiting = waiting && (enabled_now[i] || blocked);
+        }
+        for (uint32_t i: trans) {
+            for (uint32_t j: trans) {
+                if (!waiting && !enabled_now[i] && enabled_now[j]) {
+                    ok = ok && independent(_transitions[i], _transitions[j]);
+                }
+            }
+        }
+        if (!ok) {
+            continue;
+        }
+        out.clear();
+        for (uint32_t i: trans) {
+            if (enabled_now[i]) {
+                out.push_back(apply(_transitions[i], values));
+            }
+        }
+        return true;
+    }
+    return false;
+}
+
+void
+Kripke::pack(const Values &values, uint64_t *words) const {
+    memset(words, 0, state_words() * sizeof(*words));
+    for (size_t i = 0; i < _vars.size(); ++i) {
+        const Var &v = _vars[i];
+        words[v.offset / 64] |= (uint64_t)(uint32_t)(values[i] - v.min) << v.offset % 64;
+    }
+}
+
+void
+Kripke::unpack(const uint64_t *words, Values &values) const {
+    values.resize(_vars.size());
+    for (size_t i = 0; i < _vars.size(); ++i) {
+        const Var &v = _vars[i];
+        uint64_t mask = v.bits == 64 ? ~0ull : (1ull << v.bits) - 1;
+        values[i] = (int32_t)(v.min + (int64_t)(words[v.offset / 64] >> v.offset % 64 & mask));
+    }
+}
+
+string
+Kripke::show(const Values &values) const {
+    std::ostringstream out;
+    for (size_t i = 0; i < _vars.size(); ++i) {
+        out << (i ? " " : "") << _vars[i].name << "=" << values[i];
+    }
+    return out.str();
+}
+
+} // namespace model::kripke
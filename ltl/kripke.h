@@ -0,0 +1,131 @@
+/*
+ * Copyright 2024 Winking-maniac (http://github.com/Winking-maniac)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except
+ * in compliance with the License. You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed under the License
+ * is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+ * or implied. See the License for the specific language governing permissions and limitations under
+ * the License.
+ */
+
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace model::kripke {
+
+// Kripke structure given by bounded integer variables and guarded transitions of processes.
+// A state is a valuation of the variables, an atom holds in it if its conditions do. Text form:
+//
+//   # comment till end of line
+//   var x 0..3 = 1            bounds and initial value, the lower bound by default
+//   atom crit x == 2 && y != x
+//   process p                 transitions below belong to p, to "main" before any process
+//   trans x < 3 -> x = x + 1, y = 0
+//   trans true -> y = x
+//
+// Conditions compare a variable with a constant or a variable (==, !=, <, <=, >, >=). Assignments
+// of a transition are simultaneous, right side is a constant, or a variable plus or minus a
+// constant. State without enabled transitions loops to itself, the relation is total.
+// Binary form is the same model as written by save_binary(), it starts with "KRIPKEB1"
+class Kripke final {
+public:
+    enum Op : uint8_t { EQ, NE, LT, LE, GT, GE };
+
+    struct Var {
+        std::string name;
+        int32_t min, max, init;
+        uint32_t bits;    // width in a packed state
+        uint32_t offset;  // first bit in a packed state
+    };
+
+    // var op rhs, rhs is a constant or the value of variable rhs
+    struct Cond {
+        uint32_t var;
+        Op op;
+        bool rhs_var;
+        int32_t rhs;
+    };
+
+    // var = add, or var = value of variable src + add
+    struct Assign {
+        uint32_t var;
+        bool src_var;
+        uint32_t src;
+        int32_t add;
+    };
+
+    struct Trans {
+        uint32_t process;
+        std::vector<Cond> guard;
+        std::vector<Assign> assigns;
+        // Filled in on loading, for partial order reduction
+        std::vector<uint32_t> reads;   // variables of the guard and right sides, sorted
+        std::vector<uint32_t> writes;  // assigned variables, sorted
+        bool local;                     // reads nothing other processes write, writes nothing they use
+        std::vector<bool> local_guard;  // guard conditions reading nothing other processes write
+    };
+
+    struct Atom {
+        std::string name;
+        std::vector<Cond> conds;
+    };
+
+    using Values = std::vector<int32_t>;
+
+    // Reads text or binary form, exits with a message on errors
+    static Kripke load(const std::string &path);
+    void save_binary(const std::string &path) const;
+
+    const std::vector<Var>& vars() const { return _vars; }
+    const std::vector<Atom>& atoms() const { return _atoms; }
+    const std::vector<std::string>& processes() const { return _processes; }
+    const std::vector<Trans>& transitions() const { return _transitions; }
+    // Returns index of atom name, or -1
+    int32_t atom(const std::string &name) const;
+
+    Values initial() const;
+    bool holds(const Cond &cond, const Values &values) const;
+    bool holds(const std::vector<Cond> &conds, const Values &values) const;
+    bool enabled(const Trans &trans, const Values &values) const { return holds(trans.guard, values); }
+    // Desc: applies assignments of an enabled transition to values
+    Values apply(const Trans &trans, const Values &values) const;
+    // Desc: successors of all enabled transitions, values themselves for a deadlock
+    void successors(const Values &values, std::vector<Values> &out) const;
+    // Desc: successors of an ample set for partial order reduction: enabled transitions of one
+    // process, not all enabled ones, which are local and write no variable in visible. Other
+    // transitions of the process must be independent of them, or wait for the process to move:
+    // a local condition of their guard is false
+    // Returns false, out untouched, if no process has such a set
+    bool ample(const Values &values, const std::vector<bool> &visible, std::vector<Values> &out) const;
+    // Transitions commute and neither enables nor disables the other
+    static bool independent(const Trans &a, const Trans &b);
+
+    // Packed state is the bits of all variables, values taken from their lower bounds
+    size_t state_words() const { return (_bits + 63) / 64; }
+    void pack(const Values &values, uint64_t *words) const;
+    void unpack(const uint64_t *words, Values &values) const;
+    // Values as "x=1 y=0"
+    std::string show(const Values &values) const;
+
+private:
+    Kripke() {}
+    // Desc: computes packed layout of the variables
+    void layout();
+    // Desc: fills read and write sets of transitions and their locality
+    void annotate();
+
+    std::vector<Var> _vars;
+    std::vector<Atom> _atoms;
+    std::vector<std::string> _processes;
+    std::vector<Trans> _transitions;
+    std::vector<std::vector<uint32_t>> by_process;  // transitions of every process
+    size_t _bits = 0;
+};
+
+} // namespace model::kripke
@@ -370,7 +370,7 @@ pair<vector<boost::dynamic_bitset<>>, vector<vector<pair<size_t, bool>>>>
 LTL::make_states(std::vector<Atom> &atoms, std::vector<ClosureNode> &closure) {
     if (atoms.size() >= sizeof(unsigned long) * 8) {
         cerr << "Are you sure you want to make a GNBA for not less than a 2^" << atoms.size() << " states?" << endl;
-        cerr << "I guess not" << endl;
+        cerr << "I guess not, on-the-fly translation builds reachable states only" << endl;
         exit(1);
     }
 
@@ -470,8 +470,65 @@ LTL::make_states(std::vector<Atom> &atoms, std::vector<ClosureNode> &closure) {
     return std::make_pair(states, constraints);
 }
 
-fsm::Automaton
-LTL::make_buchi() {
+fsm::IndexedAutomaton
+LTL::make_buchi(Translation translation) {
+    if (translation == Translation::ON_THE_FLY) {
+        return make_buchi_on_the_fly();
+    }
+    return make_buchi_closure();
+}
+
+fsm::IndexedAutomaton
+LTL::make_buchi_on_the_fly() {
+    Tableau tableau = make_tableau();
+    const auto &atoms = tableau.atoms();
+    if (atoms.size() > fsm::IndexedAutomaton::max_atoms) {
+        cerr << "Formula has " << atoms.size() << " atoms, letters hold at most "
+             << fsm::IndexedAutomaton::max_atoms << endl;
+        exit(1);
+    }
+    fsm::IndexedAutomaton buchi;
+    for (const auto &atom: atoms) {
+        buchi.add_atom(atom);
+    }
+    // Tableau creates successors only, so all its states are reachable once every one is expanded.
+    // Its ids are dense already and are kept
+    for (uint32_t s = 0; s < tableau.size(); ++s) {
+        tableau.successors(s);
+        buchi.add_state();
+    }
+    for (size_t k = 0; k < tableau.acc_sets(); ++k) {
+        buchi.add_final_set(k);
+    }
+    buchi.set_initial(tableau.initial());
+    for (uint32_t s = 0; s < tableau.size(); ++s) {
+        for (size_t k = 0; k < tableau.acc_sets(); ++k) {
+            if (tableau.accepting(s)[k]) {
+                buchi.set_final(s, k);
+            }
+        }
+        // Edges to one target are next to each other, their literals are cubes of one guard
+        const auto &succ = tableau.successors(s);
+        fsm::IndexedAutomaton::Guard guard;
+        for (size_t i = 0; i < succ.size(); ++i) {
+            const auto &label = tableau.label(succ[i].label);
+            fsm::IndexedAutomaton::Cube cube{0, 0};
+            for (size_t j = 0; j < atoms.size(); ++j) {
+                cube.pos |= fsm::IndexedAutomaton::Letter(label.pos[j]) << j;
+                cube.neg |= fsm::IndexedAutomaton::Letter(label.neg[j]) << j;
+            }
+            guard.push_back(cube);
+            if (i + 1 == succ.size() || succ[i + 1].target != succ[i].target) {
+                buchi.add_trans(s, std::move(guard), succ[i].target);
+                guard.clear();
+            }
+        }
+    }
+    return buchi;
+}
+
+fsm::IndexedAutomaton
+LTL::make_buchi_closure() {
     this->propagate_x();
     
     auto atoms = this->make_atoms();
@@ -503,24 +560,28 @@ LTL::make_buchi() {
     }
 
     // Finally, building automaton
-    fsm::Automaton buchi;
+    fsm::IndexedAutomaton buchi;
+    // Letter bit of every atom without X
+    vector<fsm::IndexedAutomaton::Letter> atom_bits(atoms.size());
+    for (size_t j = 0; j < atoms.size(); ++j) {
+        if (atoms[j].x_count == 0) {
+            atom_bits[j] = 1ull << buchi.add_atom(atoms[j].name);
+        }
+    }
     // Setting states and initial states
     for (size_t i = 0; i < initial.size(); ++i) {
-        std::string state = "s" + std::to_string(i);
-        buchi.add_state(state);
+        buchi.add_state();
         if (initial[i] == whole_true) {
-            buchi.set_initial(state);
+            buchi.set_initial(i);
         }
     }
     // Setting transitions
     for (size_t i = 0; i < initial.size(); ++i) {
-        // Get source name
-        std::string source = "s" + std::to_string(i);
-        // Get label set
-        std::set<std::string> label;
+        // Get label
+        fsm::IndexedAutomaton::Letter label = 0;
         for (size_t j = 0; j < atoms.size(); ++j) {
             if (atoms[j].x_count == 0 && states[j][i]) {
-                label.insert(atoms[j].name);
+                label |= atom_bits[j];
             }
         }
         // Initialize transitions
@@ -530,10 +591,8 @@ LTL::make_buchi() {
         for (const auto &j : constraints[i]) {
             trans &= (j.second ? states[j.first] : ~states[j.first]);
         }
-        for (size_t j = 0; j < trans.size(); ++j) {
-            if (trans[j]) {
-                buchi.add_trans(source, label, "s" + std::to_string(j));
-            }
+        for (size_t j = trans.find_first(); j != trans.npos; j = trans.find_next(j)) {
+            buchi.add_trans(i, label, j);
         }
     }
     // Setting final states
@@ -545,11 +604,10 @@ LTL::make_buchi() {
                 for (const auto &constraint: constraints[j]) {
                     if (constraint.first == i) is_split = true;
                 }
-                std::string state = "s" + std::to_string(j);
                 if (kind == F || kind == U) {
-                    if (!states[i][j] || !is_split) buchi.set_final(state, i);
+                    if (!states[i][j] || !is_split) buchi.set_final(j, i);
                 } else {
-                    if (states[i][j] || !is_split) buchi.set_final(state, i);
+                    if (states[i][j] || !is_split) buchi.set_final(j, i);
                 }
             }
         }
@@ -14,7 +14,13 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
+#include <deque>
 #include <iostream>
+#include <map>
+#include <string>
+#include <tuple>
 #include <vector>
 #include <utility>
 #include "fsm.h"
@@ -25,13 +31,92 @@ using std::pair;
 
 namespace model::ltl {
 
+// On-the-fly tableau of a formula in negation normal form, after Gerth, Peled, Vardi and Wolper.
+// Expansion of the obligations of a state gives fully expanded nodes: literals which hold in the
+// next letter, untils fulfilled there and obligations for the letter after it. Nodes with the same
+// obligations and acceptance are one state, and the literals label the transition into it, so
+// state 0 is the initial one with the formula as its only obligation. Successors are expanded when
+// they are asked for the first time, so only reachable states are ever created
+class Tableau final {
+public:
+    // Conjunction of literals over atoms
+    struct Label {
+        boost::dynamic_bitset<> pos, neg;
+    };
+
+    struct Edge {
+        uint32_t target;
+        uint32_t label;
+    };
+
+    // Atom names, atom i is bit i of labels
+    const vector<std::string>& atoms() const { return _atoms; }
+    // Number of acceptance sets, one per U subformula
+    size_t acc_sets() const { return untils.size(); }
+    // Number of states created so far
+    size_t size() const { return states.size(); }
+
+    uint32_t initial() const { return 0; }
+    const vector<Edge>& successors(uint32_t state);
+    const Label& label(uint32_t label) const { return _labels[label]; }
+    // Acceptance sets the state belongs to
+    const boost::dynamic_bitset<>& accepting(uint32_t state) const { return states[state].acc; }
+    // Whether the formula has X, partial order reduction preserves only formulas without it
+    bool has_next() const {
+        return std::any_of(terms.begin(), terms.end(), [](const Term &t) { return t.op == NEXT; });
+    }
+
+private:
+    friend class LTL;
+
+    enum Op { TRUE, FALSE, LIT, AND, OR, NEXT, UNTIL, RELEASE };
+
+    struct Term {
+        Op op;
+        uint32_t arg1; // atom of LIT, left or the only argument of other operators
+        uint32_t arg2; // right argument of AND, OR, UNTIL, RELEASE
+        bool neg;      // negated LIT
+    };
+
+    struct StateInfo {
+        boost::dynamic_bitset<> acc;
+        boost::dynamic_bitset<> next;    // obligations for successors
+        bool expanded = false;
+        vector<Edge> succ;
+    };
+
+    Tableau() {}
+    uint32_t term(Op op, uint32_t arg1, uint32_t arg2, bool neg = false);
+    void start(uint32_t root);
+    uint32_t state(const boost::dynamic_bitset<> &acc, const boost::dynamic_bitset<> &next);
+    uint32_t intern(const Label &label);
+    vector<Edge> expand(const boost::dynamic_bitset<> &todo);
+
+    vector<std::string> _atoms;
+    vector<Term> terms;
+    std::map<std::tuple<Op, uint32_t, uint32_t, bool>, uint32_t> term_ids;
+    vector<uint32_t> complement;             // complementary literal of LIT terms
+    vector<uint32_t> untils;                 // UNTIL terms, index is acceptance set
+    std::deque<StateInfo> states;            // deque keeps successor lists in place while states are added
+    std::map<pair<boost::dynamic_bitset<>, boost::dynamic_bitset<>>, uint32_t> state_ids;
+    vector<Label> _labels;
+    std::map<pair<boost::dynamic_bitset<>, boost::dynamic_bitset<>>, uint32_t> label_ids;
+    std::map<boost::dynamic_bitset<>, vector<Edge>> covers; // expansions by obligations
+};
 
 class LTL final {
 public:
     explicit LTL(std::string &s);
     LTL() = delete;
 
-    fsm::Automaton make_buchi();
+    enum class Translation {
+        CLOSURE,   // all atom valuations and closure splits, then transitions between every pair
+        ON_THE_FLY // reachable states of the tableau only
+    };
+
+    fsm::IndexedAutomaton make_buchi(Translation translation = Translation::CLOSURE);
+    // Tableau of the formula, or of its negation for model checking
+    Tableau make_tableau(bool negated = false) const;
 
     friend std::ostream& operator <<(std::ostream &out, const LTL &l);
 private:
@@ -82,6 +167,10 @@ private:
     
     vector<Node> nodes = vector<Node>();
 
+    fsm::IndexedAutomaton make_buchi_closure();
+    fsm::IndexedAutomaton make_buchi_on_the_fly();
+    uint32_t make_term(Tableau &t, std::map<std::string, uint32_t> &atom_ids, size_t node, bool neg) const;
+
     void propagate_x();
     vector<Atom> make_atoms();
     vector<ClosureNode> make_closure(vector<Atom> &);
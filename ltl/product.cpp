@@ -0,0 +1,253 @@
+/*
+ * Copyright 2024 Winking-maniac (http://github.com/Winking-maniac)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except
+ * in compliance with the License. You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed under the License
+ * is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+ * or implied. See the License for the specific language governing permissions and limitations under
+ * the License.
+ */
+
+#include "product.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+using std::vector;
+
+namespace model::ltl {
+
+StateTable::StateTable(size_t words): words(words), slots(1024) {}
+
+uint64_t
+StateTable::hash(const uint64_t *key) const {
+    uint64_t h = 0x9e3779b97f4a7c15ull;
+    for (size_t i = 0; i < words; ++i) {
+        h ^= key[i];
+        h *= 0xbf58476d1ce4e5b9ull;
+        h ^= h >> 31;
+    }
+    return h;
+}
+
+void
+StateTable::grow() {
+    slots.assign(2 * slots.size(), 0);
+    size_t mask = slots.size() - 1;
+    for (uint32_t id = 0; id < count; ++id) {
+        size_t i = hash(key(id)) & mask;
+        while (slots[i]) {
+            i = (i + 1) & mask;
+        }
+        slots[i] = id + 1;
+    }
+}
+
+std::pair<uint32_t, bool>
+StateTable::insert(const uint64_t *k) {
+    // At most half full, probes stay short
+    if (2 * (count + 1) > slots.size()) {
+        grow();
+    }
+    size_t mask = slots.size() - 1;
+    for (size_t i = hash(k) & mask;; i = (i + 1) & mask) {
+        if (!slots[i]) {
+            keys.insert(keys.end(), k, k + words);
+            slots[i] = ++count;
+            return {count - 1, true};
+        }
+        if (!memcmp(key(slots[i] - 1), k, words * sizeof(*k))) {
+            return {slots[i] - 1, false};
+        }
+    }
+}
+
+Product::Product(const kripke::Kripke &model, Tableau &tableau):
+        model(model), tableau(tableau), state_words(model.state_words()), table(model.state_words() + 1) {
+    for (const auto &name: tableau.atoms()) {
+        int32_t atom = model.atom(name);
+        if (atom < 0) {
+            std::cerr << "Atom " << name << " of the formula is not defined in the model" << std::endl;
+            exit(1);
+        }
+        atom_of.push_back(atom);
+    }
+    visible.resize(model.vars().size());
+    for (uint32_t atom: atom_of) {
+        for (const auto &c: model.atoms()[atom].conds) {
+            visible[c.var] = true;
+            if (c.rhs_var) {
+                visible[c.rhs] = true;
+            }
+        }
+    }
+}
+
+void
+Product::initial_key(uint64_t *key) {
+    model.pack(model.initial(), key);
+    key[state_words] = tableau.initial();
+}
+
+uint32_t
+Product::initial() {
+    keys.resize(key_words());
+    initial_key(keys.data());
+    return table.insert(keys.data()).first;
+}
+
+kripke::Kripke::Values
+Product::values_key(const uint64_t *key) const {
+    kripke::Kripke::Values res;
+    model.unpack(key, res);
+    return res;
+}
+
+bool
+Product::accepting_key(const uint64_t *key) const {
+    uint32_t q = key[state_words], c = key[state_words] >> 32;
+    size_t k = tableau.acc_sets();
+    return k == 0 || (c == k - 1 && tableau.accepting(q)[c]);
+}
+
+bool
+Product::successor_keys(const uint64_t *key, vector<uint64_t> &out, bool reduce) {
+    uint32_t q = key[state_words], c = key[state_words] >> 32;
+    model.unpack(key, current);
+    // Letter of s over tableau atoms
+    boost::dynamic_bitset<> letter(atom_of.size());
+    for (size_t j = 0; j < atom_of.size(); ++j) {
+        letter[j] = model.holds(model.atoms()[atom_of[j]].conds, current);
+    }
+    size_t k = tableau.acc_sets();
+    uint64_t next_c = k && tableau.accepting(q)[c] ? (c + 1) % k : c;
+    bool expanded = false, reduced = false;
+    for (const auto &e: tableau.successors(q)) {
+        const auto &label = tableau.label(e.label);
+        if (!label.pos.is_subset_of(letter) || label.neg.intersects(letter)) {
+            continue;
+        }
+        if (!expanded) {
+            reduced = reduce && model.ample(current, visible, next);
+            if (!reduced) {
+                model.successors(current, next);
+            }
+            packed.resize(next.size() * state_words);
+            for (size_t i = 0; i < next.size(); ++i) {
+                model.pack(next[i], packed.data() + i * state_words);
+            }
+            expanded = true;
+        }
+        for (size_t i = 0; i < next.size(); ++i) {
+            out.insert(out.end(), packed.begin() + i * state_words, packed.begin() + (i + 1) * state_words);
+            out.push_back(e.target | next_c << 32);
+        }
+    }
+    return reduced;
+}
+
+bool
+Product::successors(uint32_t id, vector<uint32_t> &out, bool reduce) {
+    out.clear();
+    keys.clear();
+    bool reduced = successor_keys(table.key(id), keys, reduce);
+    for (size_t i = 0; i < keys.size(); i += key_words()) {
+        out.push_back(table.insert(keys.data() + i).first);
+    }
+    return reduced;
+}
+
+bool
+nested_dfs(Product &product, Trace *trace, bool reduce) {
+    enum Color : uint8_t { WHITE, CYAN, BLUE, RED };
+    struct Frame {
+        uint32_t id;
+        vector<uint32_t> succ;
+        size_t next;
+    };
+    vector<uint8_t> color;
+    vector<bool> reduced;
+    vector<Frame> blue, red;
+    const auto push = [&](vector<Frame> &stack, uint32_t id) {
+        stack.push_back({id, {}, 0});
+        vector<uint32_t> &succ = stack.back().succ;
+        if (&stack == &red) {
+            product.successors(id, succ, reduced[id]);
+            return;
+        }
+        bool r = product.successors(id, succ, reduce);
+        color.resize(product.size());
+        // Cycle proviso, id is about to be on the stack too
+        if (r && std::any_of(succ.begin(), succ.end(), [&](uint32_t t) { return t == id || color[t] == CYAN; })) {
+            r = product.successors(id, succ);
+            color.resize(product.size());
+        }
+        reduced.resize(product.size());
+        reduced[id] = r;
+    };
+    // Cycle found through blue stack from state t up, closed by red stack if any
+    const auto report = [&](uint32_t t) {
+        if (trace) {
+            size_t pos = 0;
+            while (blue[pos].id != t) {
+                pos++;
+            }
+            trace->prefix.clear();
+            trace->cycle.clear();
+            for (size_t i = 0; i < blue.size(); ++i) {
+                (i < pos ? trace->prefix : trace->cycle).push_back(blue[i].id);
+            }
+            for (size_t i = 1; i < red.size(); ++i) {
+                trace->cycle.push_back(red[i].id);
+            }
+        }
+        return true;
+    };
+    push(blue, product.initial());
+    color[blue.back().id] = CYAN;
+    while (!blue.empty()) {
+        Frame &f = blue.back();
+        if (f.next < f.succ.size()) {
+            uint32_t s = f.id, t = f.succ[f.next++];
+            if (color[t] == CYAN && (product.accepting(s) || product.accepting(t))) {
+                return report(t);
+            }
+            if (color[t] == WHITE) {
+                push(blue, t);
+                color[t] = CYAN;
+            }
+            continue;
+        }
+        if (product.accepting(f.id)) {
+            // Red search from the seed, states it leaves red are never searched again
+            push(red, f.id);
+            while (!red.empty()) {
+                Frame &r = red.back();
+                if (r.next < r.succ.size()) {
+                    uint32_t t = r.succ[r.next++];
+                    if (color[t] == CYAN) {
+                        return report(t);
+                    }
+                    if (color[t] == BLUE) {
+                        color[t] = RED;
+                        push(red, t);
+                    }
+                    continue;
+                }
+                red.pop_back();
+            }
+            color[f.id] = RED;
+        } else {
+            color[f.id] = BLUE;
+        }
+        blue.pop_back();
+    }
+    return false;
+}
+
+} // namespace model::ltl
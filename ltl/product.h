@@ -0,0 +1,103 @@
+/*
+ * Copyright 2024 Winking-maniac (http://github.com/Winking-maniac)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except
+ * in compliance with the License. You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed under the License
+ * is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+ * or implied. See the License for the specific language governing permissions and limitations under
+ * the License.
+ */
+
+#pragma once
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "kripke.h"
+#include "ltl.h"
+#include <boost/dynamic_bitset.hpp>
+
+namespace model::ltl {
+
+// Visited states as keys of fixed width. Keys are appended to one array, so ids are dense and stay
+// valid, and an open addressing index of ids finds them
+class StateTable final {
+public:
+    explicit StateTable(size_t words);
+
+    // Returns id of the key, and whether it was inserted now
+    std::pair<uint32_t, bool> insert(const uint64_t *key);
+    const uint64_t* key(uint32_t id) const { return keys.data() + (size_t)id * words; }
+    size_t size() const { return count; }
+    size_t bytes() const { return keys.capacity() * sizeof(uint64_t) + slots.capacity() * sizeof(uint32_t); }
+
+private:
+    uint64_t hash(const uint64_t *key) const;
+    void grow();
+
+    size_t words;
+    size_t count = 0;
+    std::vector<uint64_t> keys;
+    std::vector<uint32_t> slots;  // id + 1, 0 is empty
+};
+
+// Product of a Kripke structure and the tableau of the negated formula. State (s, q, c) is about
+// to read the letter of Kripke state s with the tableau in q, and c is the acceptance set the
+// counter waits for, so one acceptance condition is left for the nested search. Key of a state is
+// the packed variables of s, then q and c in one word. States are created when first reached
+class Product final {
+public:
+    // Exits with a message if the formula has an atom the model does not define
+    Product(const kripke::Kripke &model, Tableau &tableau);
+
+    uint32_t initial();
+    // Desc: ids of successors into out. With reduce, only of an ample set of the model state if it
+    // has one, see Kripke::ample(); variables of the formula atoms are visible
+    // Returns whether the successors were reduced
+    bool successors(uint32_t id, std::vector<uint32_t> &out, bool reduce = false);
+    bool accepting(uint32_t id) const { return accepting_key(table.key(id)); }
+    size_t size() const { return table.size(); }
+    size_t bytes() const { return table.bytes(); }
+    kripke::Kripke::Values values(uint32_t id) const { return values_key(table.key(id)); }
+
+    // Same on keys, for searches with a table of their own. Tableau must not grow meanwhile if
+    // several products share it
+    size_t key_words() const { return state_words + 1; }
+    void initial_key(uint64_t *key);
+    // Desc: keys of successors appended to out, key_words() words each
+    bool successor_keys(const uint64_t *key, std::vector<uint64_t> &out, bool reduce = false);
+    bool accepting_key(const uint64_t *key) const;
+    kripke::Kripke::Values values_key(const uint64_t *key) const;
+
+private:
+    const kripke::Kripke &model;
+    Tableau &tableau;
+    size_t state_words;
+    std::vector<uint32_t> atom_of;  // model atom of tableau atom
+    std::vector<bool> visible;      // model variables the formula atoms read
+    StateTable table;
+    // Scratch space of successors
+    std::vector<uint64_t> keys;
+    kripke::Kripke::Values current;
+    std::vector<kripke::Kripke::Values> next;
+    std::vector<uint64_t> packed;
+};
+
+// Counterexample: product states of a lasso, the last state of the cycle leads to its first one
+struct Trace {
+    std::vector<uint32_t> prefix, cycle;
+};
+
+// Desc: nested depth first search of Schwoon and Esparza. Blue search marks states on its stack
+// cyan; leaving an accepting state it starts red search, which looks for a cyan state: that closes a
+// cycle through the accepting one. Successors are generated as the search goes, it stops at the
+// first accepting cycle. With reduce, blue search takes ample sets, and expands a state fully when
+// its ample set reaches the stack, so no cycle postpones a process forever; red search expands
+// states as blue search did
+// Returns true and sets trace, if not NULL, when an accepting cycle exists
+bool nested_dfs(Product &product, Trace *trace, bool reduce = false);
+
+} // namespace model::ltl
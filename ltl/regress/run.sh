@@ -0,0 +1,23 @@
+#!/bin/sh
+# Runs ./test on every regress/*.ltl: the formula is its line that is not a "#" comment, options
+# are those of its "# args:" line, and each "# expect:" line must be a line of the output
+cd "$(dirname "$0")/.." || exit 1
+expect=$(mktemp)
+failed=0
+for f in regress/*.ltl; do
+    args=$(sed -n 's/^# args: //p' "$f")
+    out=$(grep -v '^#' "$f" | ./test $args 2>/dev/null)
+    ok=1
+    sed -n 's/^# expect: //p' "$f" > "$expect"
+    while IFS= read -r line; do
+        printf '%s\n' "$out" | grep -qxF -- "$line" || ok=0
+    done < "$expect"
+    if [ $ok = 1 ]; then
+        echo "ok   $f"
+    else
+        echo "FAIL $f"
+        failed=1
+    fi
+done
+rm -f "$expect"
+exit $failed
@@ -0,0 +1,263 @@
+/*
+ * Copyright 2024 Winking-maniac (http://github.com/Winking-maniac)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except
+ * in compliance with the License. You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed under the License
+ * is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+ * or implied. See the License for the specific language governing permissions and limitations under
+ * the License.
+ */
+
+#include "ltl.h"
+#include <algorithm>
+#include <cassert>
+#include <stack>
+#include <boost/dynamic_bitset.hpp>
+
+using std::vector;
+using std::pair;
+
+namespace model::ltl {
+
+uint32_t
+Tableau::term(Op op, uint32_t arg1, uint32_t arg2, bool neg) {
+    // AND and OR are commutative, one order of arguments is enough
+    if ((op == AND || op == OR) && arg1 > arg2) {
+        std::swap(arg1, arg2);
+    }
+    auto key = std::make_tuple(op, arg1, arg2, neg);
+    auto found = term_ids.find(key);
+    if (found != term_ids.end()) {
+        return found->second;
+    }
+    uint32_t id = terms.size();
+    terms.push_back({op, arg1, arg2, neg});
+    term_ids.emplace(key, id);
+    if (op == LIT) {
+        // Complement exists for every literal, contradiction check needs it
+        complement.resize(terms.size());
+        uint32_t other = term(LIT, arg1, 0, !neg);
+        complement.resize(terms.size());
+        complement[id] = other;
+        complement[other] = id;
+    }
+    return id;
+}
+
+uint32_t
+LTL::make_term(Tableau &t, std::map<std::string, uint32_t> &atom_ids, size_t node, bool neg) const {
+    const Node &n = nodes[node];
+    // Unary operators have argument right before them, binary ones end their arguments there
+    uint32_t a, b;
+    switch (n.kind) {
+        case ATOM: {
+            auto found = atom_ids.find(n.name);
+            if (found == atom_ids.end()) {
+                found = atom_ids.emplace(n.name, t._atoms.size()).first;
+                t._atoms.push_back(n.name);
+            }
+            return t.term(Tableau::LIT, found->second, 0, neg);
+        }
+        case NOT:
+            return make_term(t, atom_ids, node - 1, !neg);
+        case X:
+            return t.term(Tableau::NEXT, make_term(t, atom_ids, node - 1, neg), 0);
+        case F:
+            // F a = true U a, !F a = false R !a
+            a = make_term(t, atom_ids, node - 1, neg);
+            return neg ? t.term(Tableau::RELEASE, t.term(Tableau::FALSE, 0, 0), a)
+                       : t.term(Tableau::UNTIL, t.term(Tableau::TRUE, 0, 0), a);
+        case G:
+            a = make_term(t, atom_ids, node - 1, neg);
+            return neg ? t.term(Tableau::UNTIL, t.term(Tableau::TRUE, 0, 0), a)
+                       : t.term(Tableau::RELEASE, t.term(Tableau::FALSE, 0, 0), a);
+        case AND:
+        case OR:
+            a = make_term(t, atom_ids, n.arg1.second, neg);
+            b = make_term(t, atom_ids, n.arg2.second, neg);
+            return t.term((n.kind == AND) != neg ? Tableau::AND : Tableau::OR, a, b);
+        case IMPL:
+            // a -> b = !a || b, !(a -> b) = a && !b
+            a = make_term(t, atom_ids, n.arg1.second, !neg);
+            b = make_term(t, atom_ids, n.arg2.second, neg);
+            return t.term(neg ? Tableau::AND : Tableau::OR, a, b);
+        case U:
+        case R:
+            // !(a U b) = !a R !b and back
+            a = make_term(t, atom_ids, n.arg1.second, neg);
+            b = make_term(t, atom_ids, n.arg2.second, neg);
+            return t.term((n.kind == U) != neg ? Tableau::UNTIL : Tableau::RELEASE, a, b);
+    }
+    assert(false);
+    return 0;
+}
+
+Tableau
+LTL::make_tableau(bool negated) const {
+    Tableau t;
+    std::map<std::string, uint32_t> atom_ids;
+    uint32_t root = make_term(t, atom_ids, nodes.size() - 1, negated);
+    for (uint32_t i = 0; i < t.terms.size(); ++i) {
+        if (t.terms[i].op == Tableau::UNTIL) {
+            t.untils.push_back(i);
+        }
+    }
+    t.start(root);
+    return t;
+}
+
+void
+Tableau::start(uint32_t root) {
+    // Initial state reads nothing before it, the formula is what its successors owe
+    boost::dynamic_bitset<> next(terms.size());
+    next.set(root);
+    state(boost::dynamic_bitset<>(untils.size()), next);
+}
+
+uint32_t
+Tableau::state(const boost::dynamic_bitset<> &acc, const boost::dynamic_bitset<> &next) {
+    auto key = std::make_pair(acc, next);
+    auto found = state_ids.find(key);
+    if (found != state_ids.end()) {
+        return found->second;
+    }
+    uint32_t id = states.size();
+    states.push_back({acc, next});
+    state_ids.emplace(std::move(key), id);
+    return id;
+}
+
+uint32_t
+Tableau::intern(const Label &label) {
+    auto key = std::make_pair(label.pos, label.neg);
+    auto found = label_ids.find(key);
+    if (found != label_ids.end()) {
+        return found->second;
+    }
+    uint32_t id = _labels.size();
+    _labels.push_back(label);
+    label_ids.emplace(std::move(key), id);
+    return id;
+}
+
+vector<Tableau::Edge>
+Tableau::expand(const boost::dynamic_bitset<> &todo) {
+    struct Partial {
+        boost::dynamic_bitset<> todo, old, next;
+    };
+    // Fully expanded nodes as (target, literals) before interning, the same node is often reached
+    // by several splits
+    vector<pair<uint32_t, Label>> nodes;
+    std::stack<Partial> work;
+    boost::dynamic_bitset<> empty(terms.size());
+    work.push({todo, empty, empty});
+    while (!work.empty()) {
+        Partial p = std::move(work.top());
+        work.pop();
+        bool alive = true;
+        for (size_t i = p.todo.find_first(); alive && i != p.todo.npos; i = p.todo.find_first()) {
+            p.todo.reset(i);
+            if (p.old[i]) {
+                continue;
+            }
+            const Term &t = terms[i];
+            p.old.set(i);
+            switch (t.op) {
+                case TRUE:
+                    break;
+                case FALSE:
+                    alive = false;
+                    break;
+                case LIT:
+                    alive = !p.old[complement[i]];
+                    break;
+                case AND:
+                    p.todo.set(t.arg1);
+                    p.todo.set(t.arg2);
+                    break;
+                case NEXT:
+                    p.next.set(t.arg1);
+                    break;
+                case OR:
+                case UNTIL:
+                case RELEASE: {
+                    // a || b: a or b now. a U b: b now, or a now and a U b next.
+                    // a R b: a and b now, or b now and a R b next
+                    Partial other = p;
+                    if (t.op == OR) {
+                        p.todo.set(t.arg1);
+                        other.todo.set(t.arg2);
+                    } else if (t.op == UNTIL) {
+                        p.todo.set(t.arg1);
+                        p.next.set(i);
+                        other.todo.set(t.arg2);
+                    } else {
+                        p.todo.set(t.arg2);
+                        p.next.set(i);
+                        other.todo.set(t.arg1);
+                        other.todo.set(t.arg2);
+                    }
+                    // Split formula is already in old of the other branch
+                    work.push(std::move(other));
+                    break;
+                }
+            }
+        }
+        if (!alive) {
+            continue;
+        }
+        Label label{boost::dynamic_bitset<>(_atoms.size()), boost::dynamic_bitset<>(_atoms.size())};
+        for (size_t i = p.old.find_first(); i != p.old.npos; i = p.old.find_next(i)) {
+            if (terms[i].op == LIT) {
+                (terms[i].neg ? label.neg : label.pos).set(terms[i].arg1);
+            }
+        }
+        // Until is fulfilled in the node, or it is not pending at all
+        boost::dynamic_bitset<> acc(untils.size());
+        for (size_t k = 0; k < untils.size(); ++k) {
+            acc[k] = !p.old[untils[k]] || p.old[terms[untils[k]].arg2];
+        }
+        nodes.emplace_back(state(acc, p.next), std::move(label));
+    }
+    // Edge is dropped if another one to the same target needs only a part of its literals
+    auto weaker = [](const Label &a, const Label &b) {
+        return a.pos.is_subset_of(b.pos) && a.neg.is_subset_of(b.neg);
+    };
+    vector<Edge> res;
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        bool covered = false;
+        for (size_t j = 0; j < nodes.size() && !covered; ++j) {
+            covered = j != i && nodes[j].first == nodes[i].first && weaker(nodes[j].second, nodes[i].second)
+                    && (!weaker(nodes[i].second, nodes[j].second) || j < i);
+        }
+        if (!covered) {
+            res.push_back({nodes[i].first, intern(nodes[i].second)});
+        }
+    }
+    std::sort(res.begin(), res.end(), [](const Edge &a, const Edge &b) {
+        return std::tie(a.target, a.label) < std::tie(b.target, b.label);
+    });
+    return res;
+}
+
+const vector<Tableau::Edge>&
+Tableau::successors(uint32_t s) {
+    if (!states[s].expanded) {
+        // States with the same obligations have the same successors. Expansion adds states, the
+        // obligations are copied before
+        boost::dynamic_bitset<> next = states[s].next;
+        auto found = covers.find(next);
+        if (found == covers.end()) {
+            found = covers.emplace(next, expand(next)).first;
+        }
+        states[s].succ = found->second;
+        states[s].expanded = true;
+    }
+    return states[s].succ;
+}
+
+} // namespace model::ltl
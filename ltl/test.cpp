@@ -12,21 +12,149 @@
  * the License.
  */
 
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include "cndfs.h"
+#include "emptiness.h"
+#include "kripke.h"
 #include "ltl.h"
 #include "fsm.h"
+#include "product.h"
 
 using namespace model::ltl;
 using namespace model::fsm;
+using model::kripke::Kripke;
 
-int main() {
+template <class Graph>
+static void print_steps(Graph &graph, const std::vector<Lasso::Step> &steps) {
+    for (const auto &step: steps) {
+        std::cout << "  s" << step.state << " --[" << graph.label(step.state, step.edge) << "]--> s"
+                  << graph.target(step.state, step.edge) << std::endl;
+    }
+}
+
+template <class Graph>
+static void check(Graph &graph) {
+    Lasso lasso;
+    if (!find_accepting_lasso(graph, &lasso)) {
+        std::cout << "Unsatisfiable" << std::endl;
+        return;
+    }
+    std::cout << "Satisfiable, accepting lasso:" << std::endl;
+    print_steps(graph, lasso.prefix);
+    std::cout << "Cycle:" << std::endl;
+    print_steps(graph, lasso.cycle);
+}
+
+template <class Values>
+static void print_result(const Kripke &model, bool violated, const Trace &trace, Values values) {
+    if (!violated) {
+        std::cout << "Formula holds" << std::endl;
+        return;
+    }
+    std::cout << "Formula does not hold, counterexample:" << std::endl;
+    for (uint32_t id: trace.prefix) {
+        std::cout << "  " << model.show(values(id)) << std::endl;
+    }
+    std::cout << "Cycle:" << std::endl;
+    for (uint32_t id: trace.cycle) {
+        std::cout << "  " << model.show(values(id)) << std::endl;
+    }
+}
+
+int main(int argc, char **argv) {
     //const Formula &formula = G(P("p") >> F(P("q")));
+    LTL::Translation translation = LTL::Translation::CLOSURE;
+    bool satisfiability = false, degeneralized = false, reduce = false;
+    const char *model_path = nullptr, *binary_path = nullptr;
+    unsigned threads = 0, table_size = 22;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--threads") && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+            threads = threads ? threads : std::thread::hardware_concurrency();
+            threads = std::min(std::max(threads, 1u), SharedStateTable::max_threads);
+        } else if (!strcmp(argv[i], "--table-size") && i + 1 < argc) {
+            table_size = std::min(std::max(atoi(argv[++i]), 10), 31);
+        } else if (!strcmp(argv[i], "--model") && i + 1 < argc) {
+            model_path = argv[++i];
+        } else if (!strcmp(argv[i], "--save-binary") && i + 1 < argc) {
+            binary_path = argv[++i];
+        } else if (!strcmp(argv[i], "--por")) {
+            reduce = true;
+        } else if (!strcmp(argv[i], "--on-the-fly")) {
+            translation = LTL::Translation::ON_THE_FLY;
+        } else if (!strcmp(argv[i], "--check")) {
+            satisfiability = true;
+        } else if (!strcmp(argv[i], "--degeneralize")) {
+            degeneralized = true;
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--on-the-fly] [--check] [--degeneralize]" << std::endl;
+            std::cerr << "       " << argv[0] << " --model FILE [--save-binary FILE]"
+                      << " [--por | --threads N [--table-size LOG2]]" << std::endl;
+            return 1;
+        }
+    }
 
     std::string s;
     std::cout << "Formula: " << std::endl;
     std::getline(std::cin, s);
     std::cout << LTL(s) << std::endl << std::endl;
 
-    Automaton automaton = LTL(s).make_buchi();
+    if (model_path) {
+        Kripke model = Kripke::load(model_path);
+        if (binary_path) {
+            model.save_binary(binary_path);
+        }
+        // Runs of the model violating the formula are accepted by the tableau of its negation
+        Tableau tableau = LTL(s).make_tableau(true);
+        if (reduce && threads) {
+            std::cerr << "Partial order reduction is not supported with --threads" << std::endl;
+            return 1;
+        }
+        if (reduce && tableau.has_next()) {
+            std::cerr << "Partial order reduction does not preserve X, formula has it" << std::endl;
+            return 1;
+        }
+        if (threads) {
+            ParallelSearch search(model, tableau, threads, table_size);
+            Trace trace;
+            print_result(model, search.run(&trace), trace, [&](uint32_t slot) { return search.values(slot); });
+            for (size_t i = 0; i < search.stats().size(); ++i) {
+                const auto &st = search.stats()[i];
+                std::cout << "Thread " << i << ": " << st.states << " states in " << st.seconds << " s, "
+                          << (uint64_t)(st.states / std::max(st.seconds, 1e-9)) << " states/s" << std::endl;
+            }
+            std::cout << "Product states: " << search.size() << std::endl;
+            return 0;
+        }
+        Product product(model, tableau);
+        Trace trace;
+        bool violated = nested_dfs(product, &trace, reduce);
+        print_result(model, violated, trace, [&](uint32_t id) { return product.values(id); });
+        std::cout << "Product states: " << product.size() << ", " << product.bytes() << " bytes" << std::endl;
+        return 0;
+    }
+
+    if (satisfiability && !degeneralized) {
+        // Tableau is expanded as far as the search goes
+        Tableau tableau = LTL(s).make_tableau();
+        TableauGraph graph(tableau);
+        check(graph);
+        std::cout << "Tableau states built: " << tableau.size() << std::endl;
+        return 0;
+    }
+
+    IndexedAutomaton automaton = LTL(s).make_buchi(translation);
+    if (degeneralized) {
+        automaton = degeneralize(automaton);
+    }
+    if (satisfiability) {
+        AutomatonGraph graph(automaton);
+        check(graph);
+        return 0;
+    }
 
     /*
     Automaton automaton;